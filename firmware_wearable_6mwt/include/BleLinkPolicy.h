@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_gap_ble_api.h>
+#include <TlvWriter.h>
+#include <ByteOrder.h>
+
+// Política de parámetros de conexión y PHY del enlace con la tablet.
+//
+// Con la prueba en curso se pide un intervalo corto (latencia de notificación baja);
+// en reposo, un intervalo largo con slave latency para ahorrar batería. En cuanto hay
+// conexión se pide el PHY LE 2M; si la tablet no lo soporta el enlace sigue en 1M.
+class BleLinkPolicy {
+  public:
+    enum Mode : uint8_t {
+      LINK_IDLE = 0,
+      LINK_ACTIVE = 1
+    };
+
+    void onConnect(const esp_bd_addr_t peer);
+    void onDisconnect();
+
+    // Se llama periódicamente; solo pide parámetros nuevos si cambia el modo
+    void update(bool active);
+
+    // Recoge los parámetros que realmente acuerda el controlador
+    void handleGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+    // Añade la sección DIAG_TAG_LINK con los parámetros vigentes
+    void writeDiagnostics(TlvWriter &out, uint16_t mtu) const;
+
+    Mode mode() const { return currentMode; }
+
+  private:
+    void requestParams(Mode mode);
+
+    esp_bd_addr_t peerAddress = {0};
+    bool connected = false;
+    Mode currentMode = LINK_IDLE;
+
+    // Valores vigentes (unidades del estándar: intervalo en 1.25 ms, timeout en 10 ms)
+    volatile uint16_t intervalUnits = 0;
+    volatile uint16_t slaveLatency = 0;
+    volatile uint16_t supervisionTimeout = 0;
+    volatile uint8_t txPhy = 1;
+    volatile uint8_t rxPhy = 1;
+};
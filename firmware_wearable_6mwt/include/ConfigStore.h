@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+#include <DeviceConfigPacket.h>
+
+// Configuración persistente en la NVS del ESP32.
+//
+// Toda la configuración es un único blob con la estructura DeviceConfig: al arrancar
+// se lee de una vez a RAM y ya no se vuelve a tocar la flash hasta la siguiente
+// escritura. Si no hay blob, o es de otra versión, de otro tamaño o no pasa la
+// validación, se usan los valores por defecto (los que antes estaban fijos en el código).
+class ConfigStore {
+  public:
+    static DeviceConfig defaults();
+
+    // Devuelve false si no había configuración guardada válida; out queda con defaults()
+    bool load(DeviceConfig &out);
+
+    // Guarda la configuración ya validada; borra y escribe flash, no llamar en el camino
+    // de muestreo
+    bool save(const DeviceConfig &config);
+};
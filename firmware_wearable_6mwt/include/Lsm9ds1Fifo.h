@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <RawSample.h>
+
+// Acceso directo a la FIFO de 32 posiciones del LSM9DS1 (bloque acelerómetro/giroscopio).
+// La librería de Adafruit no expone la FIFO, así que los registros se manejan por I2C
+// sobre el mismo bus que usa lsm.begin().
+class Lsm9ds1Fifo {
+  public:
+    // Valores de ODR_XL ya desplazados a su posición en CTRL_REG6_XL
+    enum DataRate : uint8_t {
+      ODR_50HZ  = 0x40,
+      ODR_119HZ = 0x60,
+      ODR_238HZ = 0x80
+    };
+
+    // Valores de FS_XL ya desplazados a su posición en CTRL_REG6_XL
+    enum AccelRange : uint8_t {
+      RANGE_2G  = 0x00,
+      RANGE_4G  = 0x10,
+      RANGE_8G  = 0x18,
+      RANGE_16G = 0x08
+    };
+
+    static const uint8_t FIFO_SLOTS = 32;
+
+    // Sensibilidad de cada rango según el datasheet, en mg por cuenta
+    static float mgPerCount(AccelRange range);
+
+    // Configura ODR y activa la FIFO en modo continuo con el umbral (watermark) indicado.
+    // Con watermark = 0 la FIFO queda en bypass y las muestras se leen con readAccel().
+    // Sin giroscopio este queda apagado y la FIFO solo guarda acelerómetro. Con él
+    // (±500 dps), cada posición guarda giroscopio y acelerómetro, y el ODR común lo fija
+    // el giroscopio: 50 Hz pasa a ser 59.5 Hz.
+    bool begin(DataRate rate, uint8_t watermark, bool withGyro = false, TwoWire &wire = Wire);
+
+    // Cambia ODR, rango y watermark sin reiniciar el sensor. La FIFO se vacía al pasar
+    // por bypass, así que se pierden las muestras pendientes; solo debe llamarla la
+    // tarea que lee la FIFO. El giroscopio sigue como lo dejó begin().
+    bool configure(DataRate rate, AccelRange range, uint8_t watermark);
+
+    // Lee solo los seis registros de salida del acelerómetro (OUT_X_L_XL..OUT_Z_H_XL)
+    // en una única ráfaga, sin pasar por sensors_event_t ni convertir a float
+    bool readAccel(RawSample &out);
+
+    // Lleva el aviso de watermark (FTH) al pin INT1_A/G del LSM9DS1
+    bool enableWatermarkInterrupt();
+
+    // Número de muestras pendientes en la FIFO (campo FSS de FIFO_SRC)
+    uint8_t pending();
+
+    // Vacía la FIFO en ráfaga y reconstruye la marca de tiempo de cada muestra
+    // a partir del instante de lectura y del periodo nominal del ODR.
+    size_t drain(RawSample *out, size_t maxSamples) { return drain(out, NULL, maxSamples); }
+
+    // Igual, y con el giroscopio activo copia también su parte de cada posición en gyroOut.
+    // Las dos mitades se leen por separado, así que cada muestra es una transacción más.
+    size_t drain(RawSample *out, RawGyroSample *gyroOut, size_t maxSamples);
+
+    uint32_t samplePeriodUs() const { return periodUs; }
+    uint8_t watermark() const { return fifoWatermark; }
+    DataRate dataRate() const { return odr; }
+    AccelRange range() const { return fullScale; }
+    uint32_t overruns() const { return overrunCount; }
+    bool gyroEnabled() const { return gyroOn; }
+
+  private:
+    bool writeRegister(uint8_t reg, uint8_t value);
+    bool readRegisters(uint8_t reg, uint8_t *buffer, size_t len);
+
+    TwoWire *bus = NULL;
+    uint32_t periodUs = 0;
+    uint8_t fifoWatermark = 0;
+    uint32_t overrunCount = 0;
+    bool gyroOn = false;
+    DataRate odr = ODR_119HZ;
+    AccelRange fullScale = RANGE_2G;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <FileTransferServer.h>
+#include "SessionRecorder.h"
+
+// Sesiones grabadas en LittleFS vistas como ficheros del servicio de descarga.
+// La lista se ordena por secuencia (de la más antigua a la más reciente) y marca la sesión
+// que aún se está grabando, cuyo tamaño crece mientras tanto. Solo la usa la tarea de
+// descarga.
+class SessionFileStore : public FileTransferStore {
+  public:
+    explicit SessionFileStore(const SessionRecorder &recorder) : recorder(recorder) {}
+
+    size_t refresh() override;
+    bool info(size_t index, FileInfo &out) override;
+    bool open(uint16_t id, uint32_t &size) override;
+    size_t read(uint32_t offset, uint8_t *out, size_t len) override;
+    void close() override;
+
+  private:
+    static const size_t MAX_LISTED = 128;
+
+    bool findSequence(uint16_t id, uint32_t &sequence);
+
+    const SessionRecorder &recorder;
+    FileInfo entries[MAX_LISTED];
+    uint32_t sequences[MAX_LISTED];
+    size_t count = 0;
+    File file;
+};
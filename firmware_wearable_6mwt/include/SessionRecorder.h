@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <SessionPager.h>
+
+// Grabación de cada sesión en LittleFS: muestras crudas al ODR completo y eventos de
+// paso (formato en SessionFormat.h), para auditar resultados y reunir trazas de marcha
+// sin depender del streaming a la tablet.
+//
+// Los registros se generan en la tarea de detección y van a la doble página de
+// SessionPager; una tarea de baja prioridad escribe cada página completa en el fichero
+// de la sesión. La detección nunca espera a la flash: si la escritura se retrasa más
+// de una página, los registros se pierden y quedan contados en el registro END.
+// Antes de abrir cada sesión se borran las más antiguas hasta dejar
+// SESSION_RESERVE_BYTES libres.
+//
+// Cada sesión tiene un número de secuencia de 32 bits, que es el nombre de su fichero y
+// da el orden de antigüedad. El id de 16 bits que ven la tablet y la cabecera de la
+// sesión son sus 16 bits bajos: da la vuelta tras 65535 sesiones, pero entre las que
+// caben a la vez en la flash nunca se repite.
+class SessionRecorder {
+  public:
+    // Límites de una sesión: duración, el ODR más alto y una cadencia de carrera
+    static const uint32_t MAX_DURATION_MS = 10 * 60000UL;
+    static const uint32_t MAX_SAMPLE_RATE_HZ = 238;
+    static const uint32_t MAX_STEPS_PER_MINUTE = 240;
+    // Sitio para la sesión más grande posible (~1.07 MB), más 1/8 para los metadatos
+    // de LittleFS y la deriva del ODR real sobre el nominal
+    static constexpr size_t SESSION_RESERVE_BYTES =
+        sessionWorstCaseBytes(MAX_SAMPLE_RATE_HZ, MAX_DURATION_MS, MAX_STEPS_PER_MINUTE) * 9 / 8;
+
+    // Monta LittleFS (lo formatea si no hay sistema de ficheros) y arranca la tarea de escritura
+    bool begin(UBaseType_t writerPriority, BaseType_t writerCore);
+
+    // Productor: solo desde una tarea (la de detección, o loop() sin FIFO)
+    bool start(uint32_t t_ms, const SensorConfig &sensor);
+    void stop(uint32_t t_ms, uint32_t steps, uint32_t distanceMm);
+    void appendSamples(const RawSample *samples, size_t n);
+    void appendStep(const StepEvent &event);
+    void appendSensorConfig(const SensorConfig &sensor);
+
+    bool recording() const { return active; }
+    uint16_t sessionId() const { return sessionIdOf(currentSequence); }
+    uint32_t startTime() const { return startMs; }
+    // Instantes (t_ms de las muestras) de la primera y la última muestra grabadas en la
+    // sesión en curso o en la última; sin muestras, hasSamples() es false
+    bool hasSamples() const { return sampled; }
+    uint32_t firstSampleTime() const { return firstSampleMs; }
+    uint32_t lastSampleTime() const { return lastSampleMs; }
+    uint32_t droppedRecords() const { return pager.droppedRecords(); }
+    uint32_t writeErrors() const { return errors.load(std::memory_order_relaxed); }
+
+    static const size_t PATH_SIZE = 32;
+    // Ruta del fichero de una sesión; out necesita PATH_SIZE bytes
+    static void sessionPath(uint32_t sequence, char *out);
+    // Secuencia de la sesión a partir del nombre de su fichero ("00042.bin")
+    static bool sessionSequenceFromName(const char *name, uint32_t &sequence);
+    static uint16_t sessionIdOf(uint32_t sequence) { return (uint16_t)(sequence & 0xFFFF); }
+    static const char *sessionDir();
+
+  private:
+    enum CommandKind : uint8_t {
+      CMD_OPEN,
+      CMD_PAGE,
+      CMD_CLOSE
+    };
+
+    struct Command {
+      CommandKind kind;
+      uint8_t page;
+      uint32_t sequence;
+    };
+
+    void post(CommandKind kind, uint8_t page = 0);
+    void postSealed();
+    void makeRoom();
+    static void writerTask(void *param);
+
+    SessionPager pager;
+    QueueHandle_t commands = NULL;
+    bool active = false;
+    uint32_t currentSequence = 0;
+    uint32_t lastSequence = 0;
+    uint32_t startMs = 0;
+    bool sampled = false;
+    uint32_t firstSampleMs = 0;
+    uint32_t lastSampleMs = 0;
+    std::atomic<uint32_t> errors{0}; // Lo incrementan el productor y la tarea de escritura
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Escritura little-endian (orden estándar en BLE) sobre un buffer de bytes
+inline void putLe16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+}
+
+inline void putLe32(uint8_t *p, uint32_t v) {
+  putLe16(p, v & 0xFFFF);
+  putLe16(p + 2, v >> 16);
+}
+
+// Lectura little-endian de lo que escribe la tablet
+inline uint16_t getLe16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t getLe32(const uint8_t *p) {
+  return getLe16(p) | ((uint32_t)getLe16(p + 2) << 16);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ByteOrder.h"
+
+// Valor de la característica de cadencia.
+//
+// Formato (little-endian), versión 1:
+//   uint8 versión, uint16 cadencia (pasos/min x10, 0 = sin estimación),
+//   uint8 periodicidad de la marcha (0-100 %), uint32 picos rechazados por la cadencia
+const uint8_t CADENCE_PACKET_VERSION = 1;
+const size_t CADENCE_PACKET_SIZE = 8;
+
+inline size_t packCadence(uint8_t *out, uint16_t cadenceX10, uint8_t confidencePct, uint32_t rejectedPeaks) {
+  out[0] = CADENCE_PACKET_VERSION;
+  putLe16(out + 1, cadenceX10);
+  out[3] = confidencePct;
+  putLe32(out + 4, rejectedPeaks);
+  return CADENCE_PACKET_SIZE;
+}
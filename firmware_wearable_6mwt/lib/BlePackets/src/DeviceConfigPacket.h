@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "ByteOrder.h"
+#include "SensorConfigPacket.h"
+
+// Configuración persistente del wearable: parámetros del detector, configuración del
+// sensor con la que arranca, nombre BLE y UUIDs.
+//
+// La estructura se guarda tal cual en NVS y se copia entera a RAM al arrancar; las
+// magnitudes van en enteros para que el blob no dependa de la representación de float.
+// Los UUIDs se guardan en binario en el orden del texto (el primer byte es el de la
+// izquierda). Las características usan UUIDs de characteristicUuidBase con el último
+// byte sustituido por el sufijo de cada una.
+const uint16_t DEVICE_CONFIG_VERSION = 1;
+const size_t DEVICE_NAME_MAX = 29;
+const size_t UUID_SIZE = 16;
+
+// Bits de DeviceConfig::flags
+const uint8_t DEVICE_CONFIG_ADAPTIVE = 0x01;
+const uint8_t DEVICE_CONFIG_CADENCE_GATE = 0x02;
+const uint8_t DEVICE_CONFIG_FILTER = 0x04;
+const uint8_t DEVICE_CONFIG_FLAGS_MASK = 0x07;
+
+// Límites de validación. El umbral alto cabe en cuentas² de 32 bits hasta ~33 m/s² en
+// ±2g; por encima el acelerómetro de todas formas satura en ese rango.
+const uint16_t DEVICE_CONFIG_MIN_THRESHOLD_CMS2 = 100;
+const uint16_t DEVICE_CONFIG_MAX_THRESHOLD_CMS2 = 3000;
+const uint16_t DEVICE_CONFIG_MIN_DEBOUNCE_MS = 100;
+const uint16_t DEVICE_CONFIG_MAX_DEBOUNCE_MS = 2000;
+const uint16_t DEVICE_CONFIG_MIN_STRIDE_K = 100;   // 0.1
+const uint16_t DEVICE_CONFIG_MAX_STRIDE_K = 1000;  // 1.0
+
+struct DeviceConfig {
+  uint16_t version;
+  uint16_t thresholdHighCms2;  // Umbral alto en cm/s²
+  uint16_t thresholdLowCms2;   // Umbral bajo en cm/s²
+  uint16_t debounceMs;
+  uint16_t strideKx1000;       // Constante de Weinberg x1000
+  uint8_t flags;
+  SensorConfig sensor;
+  char deviceName[DEVICE_NAME_MAX + 1];
+  uint8_t serviceUuid[UUID_SIZE];
+  uint8_t characteristicUuidBase[UUID_SIZE];
+};
+
+// Comprueba versión, rangos, nombre ASCII imprimible y UUIDs no nulos
+inline bool validDeviceConfig(const DeviceConfig &config) {
+  if (config.version != DEVICE_CONFIG_VERSION) return false;
+  if (config.thresholdLowCms2 < DEVICE_CONFIG_MIN_THRESHOLD_CMS2) return false;
+  if (config.thresholdHighCms2 > DEVICE_CONFIG_MAX_THRESHOLD_CMS2) return false;
+  if (config.thresholdLowCms2 >= config.thresholdHighCms2) return false;
+  if (config.debounceMs < DEVICE_CONFIG_MIN_DEBOUNCE_MS || config.debounceMs > DEVICE_CONFIG_MAX_DEBOUNCE_MS) return false;
+  if (config.strideKx1000 < DEVICE_CONFIG_MIN_STRIDE_K || config.strideKx1000 > DEVICE_CONFIG_MAX_STRIDE_K) return false;
+  if (config.flags & ~DEVICE_CONFIG_FLAGS_MASK) return false;
+
+  uint8_t sensorBytes[SENSOR_CONFIG_WRITE_SIZE] = {
+    config.sensor.odrCode, config.sensor.rangeCode, config.sensor.watermark
+  };
+  SensorConfig sensor;
+  if (!parseSensorConfig(sensorBytes, sizeof(sensorBytes), sensor)) return false;
+
+  size_t nameLength = strnlen(config.deviceName, sizeof(config.deviceName));
+  if (nameLength == 0 || nameLength > DEVICE_NAME_MAX) return false;
+  for (size_t i = 0; i < nameLength; i++) {
+    if (config.deviceName[i] < 0x20 || config.deviceName[i] > 0x7E) return false;
+  }
+
+  uint8_t zero[UUID_SIZE] = {0};
+  if (memcmp(config.serviceUuid, zero, UUID_SIZE) == 0) return false;
+  if (memcmp(config.characteristicUuidBase, zero, UUID_SIZE) == 0) return false;
+  return true;
+}
+
+// Valor de la característica de configuración del wearable.
+//
+// Formato (little-endian), versión 1, igual en lectura y escritura:
+//   uint8 versión, uint16 umbral alto (cm/s²), uint16 umbral bajo (cm/s²),
+//   uint16 rebote (ms), uint16 constante de Weinberg x1000, uint8 flags,
+//   uint8 ODR, uint8 rango, uint8 watermark (códigos de SensorConfigPacket.h),
+//   char[30] nombre BLE (relleno con ceros), uint8[16] UUID del servicio,
+//   uint8[16] UUID base de las características
+const size_t DEVICE_CONFIG_PACKET_SIZE = 75;
+
+inline size_t packDeviceConfig(uint8_t *out, const DeviceConfig &config) {
+  out[0] = (uint8_t)config.version;
+  putLe16(out + 1, config.thresholdHighCms2);
+  putLe16(out + 3, config.thresholdLowCms2);
+  putLe16(out + 5, config.debounceMs);
+  putLe16(out + 7, config.strideKx1000);
+  out[9] = config.flags;
+  out[10] = config.sensor.odrCode;
+  out[11] = config.sensor.rangeCode;
+  out[12] = config.sensor.watermark;
+  memset(out + 13, 0, DEVICE_NAME_MAX + 1);
+  memcpy(out + 13, config.deviceName, strnlen(config.deviceName, DEVICE_NAME_MAX));
+  memcpy(out + 43, config.serviceUuid, UUID_SIZE);
+  memcpy(out + 59, config.characteristicUuidBase, UUID_SIZE);
+  return DEVICE_CONFIG_PACKET_SIZE;
+}
+
+// Devuelve false si la escritura no tiene el tamaño esperado o no pasa la validación
+inline bool parseDeviceConfig(const uint8_t *data, size_t len, DeviceConfig &out) {
+  if (len != DEVICE_CONFIG_PACKET_SIZE) return false;
+  DeviceConfig config;
+  config.version = data[0];
+  config.thresholdHighCms2 = getLe16(data + 1);
+  config.thresholdLowCms2 = getLe16(data + 3);
+  config.debounceMs = getLe16(data + 5);
+  config.strideKx1000 = getLe16(data + 7);
+  config.flags = data[9];
+  config.sensor.odrCode = data[10];
+  config.sensor.rangeCode = data[11];
+  config.sensor.watermark = data[12];
+  memcpy(config.deviceName, data + 13, DEVICE_NAME_MAX + 1);
+  memcpy(config.serviceUuid, data + 43, UUID_SIZE);
+  memcpy(config.characteristicUuidBase, data + 59, UUID_SIZE);
+  if (!validDeviceConfig(config)) return false;
+  out = config;
+  return true;
+}
+
+// Texto 8-4-4-4-12 de un UUID binario; out necesita 37 bytes
+inline void formatUuid(const uint8_t *uuid, char *out) {
+  snprintf(out, 37,
+           "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+           uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7],
+           uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ByteOrder.h"
+
+// Valor de la característica de vueltas (un giro de 180° al final del pasillo).
+//
+// Formato (little-endian), versión 1:
+//   uint8 versión, uint16 giros acumulados, uint32 t_ms del último giro,
+//   int16 ángulo del giro en grados (con signo), uint32 pasos acumulados en ese instante
+const uint8_t LAP_PACKET_VERSION = 1;
+const size_t LAP_PACKET_SIZE = 13;
+
+inline size_t packLap(uint8_t *out, uint16_t laps, uint32_t t_ms, int16_t degrees, uint32_t steps) {
+  out[0] = LAP_PACKET_VERSION;
+  putLe16(out + 1, laps);
+  putLe32(out + 3, t_ms);
+  putLe16(out + 7, (uint16_t)degrees);
+  putLe32(out + 9, steps);
+  return LAP_PACKET_SIZE;
+}
@@ -0,0 +1,40 @@
+#include "RawStreamPacket.h"
+#include "ByteOrder.h"
+
+void RawStreamPacker::setMaxSize(size_t bytes) {
+  if (bytes > MAX_PACKET_SIZE) bytes = MAX_PACKET_SIZE;
+  // Como mínimo debe caber una muestra (MTU por defecto de 23 bytes)
+  if (bytes < HEADER_SIZE + SAMPLE_SIZE) bytes = HEADER_SIZE + SAMPLE_SIZE;
+  maxSize = bytes;
+}
+
+void RawStreamPacker::start(uint16_t lostSamples) {
+  if (length > 0 && count() > 0) seq++;
+  buffer[0] = VERSION;
+  buffer[1] = 0;
+  putLe16(&buffer[2], seq);
+  putLe32(&buffer[4], 0);
+  putLe16(&buffer[8], lostSamples);
+  length = HEADER_SIZE;
+}
+
+bool RawStreamPacker::append(const RawSample &sample) {
+  if (length == 0) start(0);
+
+  if (count() == 0) {
+    t0 = sample.t_ms;
+    putLe32(&buffer[4], t0);
+  }
+
+  uint32_t dt = sample.t_ms - t0;
+  if (length + SAMPLE_SIZE > maxSize || dt > 0xFFFF || count() == 0xFF) return false;
+
+  uint8_t *p = &buffer[length];
+  putLe16(p, (uint16_t)dt);
+  putLe16(p + 2, (uint16_t)sample.x);
+  putLe16(p + 4, (uint16_t)sample.y);
+  putLe16(p + 6, (uint16_t)sample.z);
+  length += SAMPLE_SIZE;
+  buffer[1]++;
+  return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <RawSample.h>
+
+// Empaquetado de muestras crudas para la característica de streaming.
+//
+// Formato (little-endian), versión 1:
+//   cabecera  uint8 versión, uint8 nº de muestras, uint16 secuencia,
+//             uint32 t0_ms (instante de la primera muestra),
+//             uint16 muestras perdidas en el dispositivo desde el paquete anterior
+//   muestras  uint16 dt_ms respecto a t0, int16 x, int16 y, int16 z (cuentas del ADC)
+//
+// Las cuentas están en la escala completa de la SensorConfig activa, no siempre en
+// ±2g: el cliente la conoce leyendo la característica de configuración del sensor
+// (sufijo 0xae, SensorConfigPacket.h), cuyo código de rango 0-3 es ±2/4/8/16 g.
+//
+// La secuencia aumenta en uno por paquete: un salto en el receptor indica una
+// notificación perdida en el enlace.
+class RawStreamPacker {
+  public:
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 10;
+    static const size_t SAMPLE_SIZE = 8;
+    // Carga útil máxima de una notificación con MTU 247
+    static const size_t MAX_PACKET_SIZE = 244;
+
+    // Tamaño de paquete permitido por el MTU actual (MTU - 3 bytes de cabecera ATT)
+    void setMaxSize(size_t bytes);
+
+    // Empieza un paquete nuevo con el siguiente número de secuencia
+    void start(uint16_t lostSamples);
+
+    // Añade una muestra; devuelve false si ya no cabe y hay que enviar el paquete
+    bool append(const RawSample &sample);
+
+    const uint8_t *data() const { return buffer; }
+    size_t size() const { return length; }
+    uint8_t count() const { return buffer[1]; }
+    uint16_t sequence() const { return seq; }
+
+  private:
+    uint8_t buffer[MAX_PACKET_SIZE];
+    size_t length = 0;
+    size_t maxSize = HEADER_SIZE + SAMPLE_SIZE;
+    uint16_t seq = 0;
+    uint32_t t0 = 0;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ByteOrder.h"
+
+// Característica de grabación de sesiones en flash.
+//
+// Escritura (1 byte): RECORDING_STOP o RECORDING_START.
+// Lectura (formato little-endian), versión 1:
+//   uint8 versión, uint8 grabando (0/1), uint16 id de la sesión actual o última,
+//   uint32 registros perdidos en ella, uint32 errores de escritura desde el arranque
+const uint8_t RECORDING_STOP = 0x00;
+const uint8_t RECORDING_START = 0x01;
+
+const uint8_t RECORDING_PACKET_VERSION = 1;
+const size_t RECORDING_PACKET_SIZE = 12;
+
+inline size_t packRecordingStatus(uint8_t *out, bool recording, uint16_t sessionId,
+                                  uint32_t droppedRecords, uint32_t writeErrors) {
+  out[0] = RECORDING_PACKET_VERSION;
+  out[1] = recording ? 1 : 0;
+  putLe16(out + 2, sessionId);
+  putLe32(out + 4, droppedRecords);
+  putLe32(out + 8, writeErrors);
+  return RECORDING_PACKET_SIZE;
+}
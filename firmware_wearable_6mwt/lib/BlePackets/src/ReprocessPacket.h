@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ByteOrder.h"
+
+// Característica del reprocesado de la prueba (StepReprocessor).
+//
+// Escritura: 1 byte REPROCESS_LAST_SESSION reprocesa la última sesión grabada; 8 bytes
+// (uint32 desde, uint32 hasta, t_ms del wearable) reprocesan esa ventana del historial.
+// Lectura y notificación al terminar (little-endian), versión 1:
+//   uint8 versión, uint8 estado, uint16 tiempo de cálculo (ms),
+//   uint32 t_ms de la primera y de la última muestra procesadas,
+//   uint16 pasos del detector en vivo en la ventana, uint16 pasos corregidos
+//   (saturados; una prueba de seis minutos no pasa de unos 1200),
+//   uint32 distancia corregida (mm)
+// Son 20 bytes: la notificación cabe entera con el MTU por defecto (23).
+// Estados: REPROCESS_IDLE, REPROCESS_RUNNING o 2 + StepReprocessor::Status
+// (2 = hecho, 3 = sin datos, 4 = historial sobrescrito, 5 = sin memoria).
+const uint8_t REPROCESS_LAST_SESSION = 0x01;
+const size_t REPROCESS_WINDOW_WRITE_SIZE = 8;
+
+const uint8_t REPROCESS_IDLE = 0;
+const uint8_t REPROCESS_RUNNING = 1;
+const uint8_t REPROCESS_FINISHED = 2;
+
+const uint8_t REPROCESS_PACKET_VERSION = 1;
+const size_t REPROCESS_PACKET_SIZE = 20;
+
+inline size_t packReprocessResult(uint8_t *out, uint8_t status, uint16_t elapsedMs,
+                                  uint32_t fromMs, uint32_t toMs, uint32_t liveSteps,
+                                  uint32_t steps, uint32_t distanceMm) {
+  out[0] = REPROCESS_PACKET_VERSION;
+  out[1] = status;
+  putLe16(out + 2, elapsedMs);
+  putLe32(out + 4, fromMs);
+  putLe32(out + 8, toMs);
+  putLe16(out + 12, (uint16_t)(liveSteps > 0xFFFF ? 0xFFFF : liveSteps));
+  putLe16(out + 14, (uint16_t)(steps > 0xFFFF ? 0xFFFF : steps));
+  putLe32(out + 16, distanceMm);
+  return REPROCESS_PACKET_SIZE;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Valor de la característica de configuración del sensor.
+//
+// Escritura (3 bytes): uint8 ODR, uint8 rango, uint8 watermark de la FIFO.
+//   ODR:   0 = 50 Hz, 1 = 119 Hz, 2 = 238 Hz
+//   Rango: 0 = ±2g, 1 = ±4g, 2 = ±8g, 3 = ±16g
+//   Watermark: 1-31 muestras por ráfaga (ignorado sin FIFO)
+// Lectura (4 bytes), versión 1: uint8 versión y los tres campos anteriores, tal como
+// quedaron aplicados (watermark 0 si el firmware lee sin FIFO). Las cuentas del
+// streaming crudo están en el rango leído aquí.
+const uint8_t SENSOR_CONFIG_PACKET_VERSION = 1;
+const size_t SENSOR_CONFIG_WRITE_SIZE = 3;
+const size_t SENSOR_CONFIG_PACKET_SIZE = 4;
+
+const uint8_t SENSOR_CONFIG_ODR_CODES = 3;
+const uint8_t SENSOR_CONFIG_RANGE_CODES = 4;
+const uint8_t SENSOR_CONFIG_MAX_WATERMARK = 31;
+
+struct SensorConfig {
+  uint8_t odrCode;
+  uint8_t rangeCode;
+  uint8_t watermark;
+};
+
+// Devuelve false si la escritura no tiene el tamaño esperado o algún campo se sale de rango
+inline bool parseSensorConfig(const uint8_t *data, size_t len, SensorConfig &out) {
+  if (len != SENSOR_CONFIG_WRITE_SIZE) return false;
+  if (data[0] >= SENSOR_CONFIG_ODR_CODES || data[1] >= SENSOR_CONFIG_RANGE_CODES) return false;
+  if (data[2] == 0 || data[2] > SENSOR_CONFIG_MAX_WATERMARK) return false;
+  out.odrCode = data[0];
+  out.rangeCode = data[1];
+  out.watermark = data[2];
+  return true;
+}
+
+inline size_t packSensorConfig(uint8_t *out, const SensorConfig &config) {
+  out[0] = SENSOR_CONFIG_PACKET_VERSION;
+  out[1] = config.odrCode;
+  out[2] = config.rangeCode;
+  out[3] = config.watermark;
+  return SENSOR_CONFIG_PACKET_SIZE;
+}
@@ -0,0 +1,35 @@
+#include "StepEventPacket.h"
+#include "ByteOrder.h"
+
+void StepEventPacker::setMaxSize(size_t bytes) {
+  if (bytes > MAX_PACKET_SIZE) bytes = MAX_PACKET_SIZE;
+  // Como mínimo debe caber un evento: 20 bytes, lo que deja el MTU por defecto de 23
+  if (bytes < HEADER_SIZE + EVENT_SIZE) bytes = HEADER_SIZE + EVENT_SIZE;
+  // Un paquete ya empezado no se recorta: el nuevo límite se aplica a los siguientes eventos
+  maxSize = bytes;
+}
+
+bool StepEventPacker::append(const StepEvent &event) {
+  if (length == 0) {
+    buffer[0] = VERSION;
+    buffer[1] = 0;
+    putLe16(&buffer[2], seq);
+    length = HEADER_SIZE;
+  }
+  if (full() || buffer[1] == 0xFF) return false;
+
+  uint8_t *p = &buffer[length];
+  putLe32(p, event.t_ms);
+  putLe32(p + 4, event.steps);
+  putLe16(p + 8, event.peakMg);
+  putLe16(p + 10, event.intervalMs);
+  putLe32(p + 12, event.distanceMm);
+  length += EVENT_SIZE;
+  buffer[1]++;
+  return true;
+}
+
+void StepEventPacker::clear() {
+  if (count() > 0) seq++;
+  length = 0;
+}
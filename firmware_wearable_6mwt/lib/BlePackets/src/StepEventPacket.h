@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Evento de paso. En la notificación viaja todo salvo strideMm, que la tablet obtiene
+// como diferencia de distanceMm entre pasos consecutivos
+struct StepEvent {
+  uint32_t t_ms;        // Instante del paso (reloj del wearable)
+  uint32_t steps;       // Total acumulado tras este paso
+  uint16_t peakMg;      // Pico del módulo de la aceleración durante el paso, en mg
+  uint16_t intervalMs;  // Tiempo desde el paso anterior (0xFFFF si no lo hay o no cabe)
+  uint16_t strideMm;    // Longitud estimada de este paso
+  uint32_t distanceMm;  // Distancia acumulada tras este paso
+};
+
+// Empaquetado de varios eventos de paso por notificación.
+//
+// Formato (little-endian), versión 2:
+//   cabecera  uint8 versión, uint8 nº de eventos, uint16 secuencia
+//   eventos   uint32 t_ms, uint32 pasos acumulados, uint16 pico (mg), uint16 intervalo (ms),
+//             uint32 distancia acumulada (mm)
+// La versión 1 era igual sin la distancia (eventos de 12 bytes). Un evento con su
+// cabecera ocupa 20 bytes, lo que cabe en una notificación con el MTU por defecto (23).
+class StepEventPacker {
+  public:
+    static const uint8_t VERSION = 2;
+    static const size_t HEADER_SIZE = 4;
+    static const size_t EVENT_SIZE = 16;
+    static const size_t MAX_PACKET_SIZE = 244;
+
+    // Tamaño de paquete permitido por el MTU actual (MTU - 3 bytes de cabecera ATT)
+    void setMaxSize(size_t bytes);
+
+    // Añade un evento; devuelve false si ya no cabe y hay que enviar el paquete
+    bool append(const StepEvent &event);
+
+    // Tras enviar el paquete: vacía el buffer y avanza la secuencia
+    void clear();
+
+    const uint8_t *data() const { return buffer; }
+    size_t size() const { return length; }
+    uint8_t count() const { return length == 0 ? 0 : buffer[1]; }
+    bool full() const { return length + EVENT_SIZE > maxSize; }
+    uint16_t sequence() const { return seq; }
+
+  private:
+    uint8_t buffer[MAX_PACKET_SIZE];
+    size_t length = 0;
+    size_t maxSize = HEADER_SIZE + EVENT_SIZE;
+    uint16_t seq = 0;
+};
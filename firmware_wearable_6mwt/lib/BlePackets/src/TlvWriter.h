@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Construye el valor de la característica de diagnóstico.
+//
+// Formato: uint8 versión, seguido de secciones [uint8 etiqueta][uint8 longitud][datos].
+// Un lector que no conozca una etiqueta puede saltarla con su longitud, así que cada
+// módulo añade su sección sin romper a los clientes existentes.
+class TlvWriter {
+  public:
+    static const uint8_t VERSION = 1;
+
+    TlvWriter(uint8_t *buffer, size_t capacity) : buf(buffer), cap(capacity) {
+      if (cap > 0) buf[len++] = VERSION;
+    }
+
+    // Reserva una sección y devuelve dónde escribir sus datos (NULL si no cabe)
+    uint8_t *section(uint8_t tag, uint8_t length) {
+      if (len + 2 + length > cap) return NULL;
+      buf[len++] = tag;
+      buf[len++] = length;
+      uint8_t *payload = &buf[len];
+      len += length;
+      return payload;
+    }
+
+    size_t size() const { return len; }
+
+  private:
+    uint8_t *buf;
+    size_t cap;
+    size_t len = 0;
+};
+
+// Etiquetas de las secciones de diagnóstico
+enum DiagnosticsTag : uint8_t {
+  DIAG_TAG_LINK = 0x01,
+  DIAG_TAG_HISTORY = 0x02,
+  DIAG_TAG_NOTIFY = 0x03,
+  DIAG_TAG_TIMING = 0x04
+};
@@ -0,0 +1,105 @@
+#include "BlockKernels.h"
+
+#if BLOCK_KERNELS_SIMD
+#include <esp_dsp.h>
+#endif
+
+void blockMagnitudeSquaredScalar(const RawSample *in, uint32_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = magnitudeSquared(in[i]);
+  }
+}
+
+void blockToFloat(const uint32_t *in, float *out, size_t n, float scale) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = (float)in[i] * scale;
+  }
+}
+
+// Cuatro acumuladores independientes: el bucle no espera a la suma anterior
+float blockDotScalar(const float *a, const float *b, size_t n) {
+  float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += a[i] * b[i];
+    s1 += a[i + 1] * b[i + 1];
+    s2 += a[i + 2] * b[i + 2];
+    s3 += a[i + 3] * b[i + 3];
+  }
+  for (; i < n; i++) s0 += a[i] * b[i];
+  return (s0 + s1) + (s2 + s3);
+}
+
+void blockSumsScalar(const float *in, size_t n, float &sum, float &sumSq) {
+  float s = 0, sq = 0;
+  for (size_t i = 0; i < n; i++) {
+    s += in[i];
+    sq += in[i] * in[i];
+  }
+  sum = s;
+  sumSq = sq;
+}
+
+#if BLOCK_KERNELS_SIMD
+// Los ejes se recorren directamente sobre el array de RawSample, saltando de muestra
+// en muestra: el paso en int16 es el tamaño de la estructura
+static const int SAMPLE_STEP = sizeof(RawSample) / sizeof(int16_t);
+static_assert(sizeof(RawSample) % sizeof(int16_t) == 0, "RawSample debe medir un número entero de int16");
+
+// Cuadrados de 15 bits por eje en tandas de 32 muestras, que caben en la pila
+static const size_t MAGNITUDE_CHUNK = 32;
+
+void blockMagnitudeSquared(const RawSample *in, uint32_t *out, size_t n) {
+  int16_t sq[3][MAGNITUDE_CHUNK];
+  while (n > 0) {
+    size_t chunk = n < MAGNITUDE_CHUNK ? n : MAGNITUDE_CHUNK;
+    dsps_mul_s16(&in->x, &in->x, sq[0], (int)chunk, SAMPLE_STEP, SAMPLE_STEP, 1, BLOCK_MAGNITUDE_SIMD_SHIFT);
+    dsps_mul_s16(&in->y, &in->y, sq[1], (int)chunk, SAMPLE_STEP, SAMPLE_STEP, 1, BLOCK_MAGNITUDE_SIMD_SHIFT);
+    dsps_mul_s16(&in->z, &in->z, sq[2], (int)chunk, SAMPLE_STEP, SAMPLE_STEP, 1, BLOCK_MAGNITUDE_SIMD_SHIFT);
+    // Cada cuadrado desplazado vale como mucho 2^15: leído sin signo es exacto
+    for (size_t i = 0; i < chunk; i++) {
+      uint32_t sum = (uint32_t)(uint16_t)sq[0][i] + (uint16_t)sq[1][i] + (uint16_t)sq[2][i];
+      out[i] = sum << BLOCK_MAGNITUDE_SIMD_SHIFT;
+    }
+    in += chunk;
+    out += chunk;
+    n -= chunk;
+  }
+}
+
+// Bloques de unos para obtener la suma como producto escalar con el núcleo vectorial
+static const size_t ONES_SIZE = 128;
+static const float ONES[ONES_SIZE] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+float blockDot(const float *a, const float *b, size_t n) {
+  float result = 0;
+  dsps_dotprod_f32(a, b, &result, (int)n);
+  return result;
+}
+
+void blockSums(const float *in, size_t n, float &sum, float &sumSq) {
+  sumSq = blockDot(in, in, n);
+  sum = 0;
+  for (size_t done = 0; done < n; done += ONES_SIZE) {
+    size_t chunk = n - done < ONES_SIZE ? n - done : ONES_SIZE;
+    sum += blockDot(in + done, ONES, chunk);
+  }
+}
+#else
+void blockMagnitudeSquared(const RawSample *in, uint32_t *out, size_t n) {
+  blockMagnitudeSquaredScalar(in, out, n);
+}
+
+float blockDot(const float *a, const float *b, size_t n) {
+  return blockDotScalar(a, b, n);
+}
+
+void blockSums(const float *in, size_t n, float &sum, float &sumSq) {
+  blockSumsScalar(in, n, sum, sumSq);
+}
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <RawSample.h>
+
+// Núcleos de procesado por bloques (una ráfaga de la FIFO o una ventana de análisis).
+//
+// En el ESP32-S3, si el core de Arduino trae esp-dsp, los núcleos vectoriales usan las
+// rutinas de esp-dsp que aprovechan las instrucciones PIE del S3: dsps_mul_s16 para el
+// módulo² en int16 y dsps_dotprod_f32 para el producto escalar en float. En el resto
+// (entorno nativo, otros chips, o con BLOCK_KERNELS_SCALAR definido) se usan las
+// versiones escalares, que siempre están disponibles para comparar en tools/bench.
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(BLOCK_KERNELS_SCALAR) && __has_include(<esp_dsp.h>)
+#define BLOCK_KERNELS_SIMD 1
+#else
+#define BLOCK_KERNELS_SIMD 0
+#endif
+
+// Módulo² en cuentas de cada muestra del bloque. La versión vectorial multiplica en
+// carriles de 16 bits, así que cada cuadrado pierde sus 15 bits bajos
+// (BLOCK_MAGNITUDE_SIMD_SHIFT): el resultado queda por debajo del exacto en menos de
+// 3 * 2^15 cuentas². A ±2g eso es < 4e-4 de g², por debajo del ruido del sensor; como
+// el error va en cuentas, crece con el rango (~2 % de g² a ±16g). Con
+// BLOCK_KERNELS_SCALAR el bloque da exactamente lo mismo que magnitudeSquared().
+void blockMagnitudeSquared(const RawSample *in, uint32_t *out, size_t n);
+void blockMagnitudeSquaredScalar(const RawSample *in, uint32_t *out, size_t n);
+
+#if BLOCK_KERNELS_SIMD
+const int BLOCK_MAGNITUDE_SIMD_SHIFT = 15;
+#else
+const int BLOCK_MAGNITUDE_SIMD_SHIFT = 0;
+#endif
+
+// Conversión a float con un factor de escala, para los núcleos de rasgos
+void blockToFloat(const uint32_t *in, float *out, size_t n, float scale);
+
+// Producto escalar de dos bloques
+float blockDot(const float *a, const float *b, size_t n);
+float blockDotScalar(const float *a, const float *b, size_t n);
+
+// Suma y suma de cuadrados de un bloque (base de media y varianza)
+void blockSums(const float *in, size_t n, float &sum, float &sumSq);
+void blockSumsScalar(const float *in, size_t n, float &sum, float &sumSq);
+
+// Media y varianza móviles sobre los últimos Blocks bloques.
+//
+// Cada bloque entra con un solo recorrido (blockSums) y la ventana se actualiza
+// restando las sumas del bloque que sale: O(1) por bloque además de ese recorrido.
+// Las sumas por bloque se guardan aparte, así que no hace falta conservar las muestras.
+template <size_t Blocks>
+class BlockMovingStats {
+  public:
+    void push(const float *block, size_t n) {
+      Entry &e = entries[next];
+      total -= e.sum;
+      totalSq -= e.sumSq;
+      count -= e.n;
+      blockSums(block, n, e.sum, e.sumSq);
+      e.n = (uint32_t)n;
+      total += e.sum;
+      totalSq += e.sumSq;
+      count += e.n;
+      next = (next + 1) % Blocks;
+    }
+
+    void reset() {
+      for (Entry &e : entries) e = Entry();
+      total = 0;
+      totalSq = 0;
+      count = 0;
+      next = 0;
+    }
+
+    uint32_t samples() const { return count; }
+    float mean() const { return count > 0 ? (float)(total / count) : 0.0F; }
+
+    float variance() const {
+      if (count < 2) return 0.0F;
+      double m = total / count;
+      double v = totalSq / count - m * m;
+      return v > 0 ? (float)v : 0.0F;
+    }
+
+  private:
+    struct Entry {
+      float sum = 0;
+      float sumSq = 0;
+      uint32_t n = 0;
+    };
+
+    Entry entries[Blocks];
+    // En double: las restas de la ventana no acumulan error a lo largo de la prueba
+    double total = 0;
+    double totalSq = 0;
+    uint32_t count = 0;
+    size_t next = 0;
+};
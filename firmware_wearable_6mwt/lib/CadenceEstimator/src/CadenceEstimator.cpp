@@ -0,0 +1,109 @@
+#include "CadenceEstimator.h"
+
+#include <math.h>
+#include <string.h>
+
+CadenceEstimator::CadenceEstimator(double sampleRateHz) {
+  setSampleRate(sampleRateHz);
+}
+
+void CadenceEstimator::setSampleRate(double sampleRateHz) {
+  double d = floor(sampleRateHz / DECIMATED_RATE_HZ + 0.5);
+  decimation = (uint8_t)(d < 1 ? 1 : d > 8 ? 8 : d);
+  decimatedRate = (float)(sampleRateHz / decimation);
+  minLag = (size_t)floor(MIN_PERIOD_S * decimatedRate);
+  if (minLag < 2) minLag = 2;
+  maxLag = (size_t)ceil(MAX_PERIOD_S * decimatedRate);
+  // La interpolación parabólica necesita un retardo más allá del último candidato
+  if (maxLag > MAX_LAG - 1) maxLag = MAX_LAG - 1;
+  forget = 1.0F - 1.0F / (float)(FORGET_SECONDS * decimatedRate);
+  historyNeeded = (uint32_t)(FORGET_SECONDS * decimatedRate);
+  reset();
+}
+
+void CadenceEstimator::reset() {
+  accumulator = 0;
+  accumulated = 0;
+  mean = 0;
+  meanStarted = false;
+  memset(history, 0, sizeof(history));
+  memset(corr, 0, sizeof(corr));
+  decimatedCount = 0;
+  sinceEstimate = 0;
+  period = 0;
+  conf = 0;
+}
+
+void CadenceEstimator::push(uint32_t magnitudeSq) {
+  accumulator += magnitudeSq;
+  if (++accumulated < decimation) return;
+  float x = (float)accumulator / accumulated;
+  accumulator = 0;
+  accumulated = 0;
+  pushDecimated(x);
+}
+
+void CadenceEstimator::pushDecimated(float x) {
+  // La media sigue a la gravedad y a la postura con la misma constante que el olvido
+  if (!meanStarted) {
+    mean = x;
+    meanStarted = true;
+  }
+  mean += (x - mean) * (1.0F - forget);
+  x -= mean;
+
+  // history[MAX_LAG - l] es la muestra de hace l posiciones
+  corr[0] = forget * corr[0] + x * x;
+  for (size_t l = 1; l <= maxLag + 1; l++) {
+    corr[l] = forget * corr[l] + x * history[MAX_LAG - l];
+  }
+  memmove(history, history + 1, (MAX_LAG - 1) * sizeof(float));
+  history[MAX_LAG - 1] = x;
+  decimatedCount++;
+
+  if (++sinceEstimate >= ESTIMATE_EVERY) {
+    sinceEstimate = 0;
+    estimate();
+  }
+}
+
+void CadenceEstimator::estimate() {
+  if (!ready() || corr[0] <= 0) {
+    period = 0;
+    conf = 0;
+    return;
+  }
+
+  // El módulo tiene un máximo por paso y otro, a veces mayor, por zancada (dos pasos):
+  // se toma el primer máximo local que llegue al 80 % del mayor
+  float best = 0;
+  for (size_t l = minLag; l <= maxLag; l++) {
+    if (corr[l] > best) best = corr[l];
+  }
+  if (best <= 0) {
+    period = 0;
+    conf = 0;
+    return;
+  }
+
+  size_t lag = 0;
+  for (size_t l = minLag; l <= maxLag; l++) {
+    if (corr[l] >= 0.8F * best && corr[l] >= corr[l - 1] && corr[l] >= corr[l + 1]) {
+      lag = l;
+      break;
+    }
+  }
+  if (lag == 0) {
+    // Sin máximo local en el rango (p. ej. el mayor está en el borde): no hay periodo
+    period = 0;
+    conf = 0;
+    return;
+  }
+
+  float ym = corr[lag - 1], y0 = corr[lag], yp = corr[lag + 1];
+  float denom = ym - 2 * y0 + yp;
+  float offset = denom < 0 ? 0.5F * (ym - yp) / denom : 0;
+  period = (uint32_t)((lag + offset) * 1000.0F / decimatedRate + 0.5F);
+  conf = y0 / corr[0];
+  if (conf > 1) conf = 1;
+}
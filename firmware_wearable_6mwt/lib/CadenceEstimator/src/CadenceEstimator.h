@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Estimador incremental de cadencia por autocorrelación.
+//
+// La señal (módulo² filtrado) se diezma por promedio a ~30 Hz, se le quita la media
+// y con cada muestra diezmada se actualiza la autocorrelación de los retardos que
+// corresponden a un paso de 0.3 a 1.5 s, con olvido exponencial (~4 s). Cada
+// ESTIMATE_EVERY muestras diezmadas, aproximadamente una ráfaga de la FIFO, se busca
+// el primer máximo fuerte y se interpola su posición con una parábola.
+//
+// El coste está acotado: O(MAX_LAG) por muestra diezmada y O(MAX_LAG) por estimación,
+// sin heap. No depende de Arduino.
+class CadenceEstimator {
+  public:
+    static constexpr double DECIMATED_RATE_HZ = 30.0;
+    static constexpr double MIN_PERIOD_S = 0.3;   // 200 pasos/min
+    static constexpr double MAX_PERIOD_S = 1.5;   // 40 pasos/min
+    static constexpr double FORGET_SECONDS = 4.0;
+    // Margen para ritmos diezmados de hasta 32 Hz (p. ej. 119 / 4)
+    static const size_t MAX_LAG = 48;
+    static const size_t ESTIMATE_EVERY = 5;
+
+    explicit CadenceEstimator(double sampleRateHz);
+
+    // Reconfigura para otro ritmo de muestreo y empieza de cero
+    void setSampleRate(double sampleRateHz);
+
+    void push(uint32_t magnitudeSq);
+    void reset();
+
+    // Periodo de paso estimado en ms (0 si aún no hay estimación)
+    uint32_t periodMs() const { return period; }
+    // Cadencia en pasos por minuto x10 (0 si aún no hay estimación)
+    uint16_t cadenceX10() const { return period > 0 ? (uint16_t)(600000UL / period) : 0; }
+    // Periodicidad de la señal: autocorrelación normalizada en el máximo (0..1)
+    float confidence() const { return conf; }
+    // Hay historia suficiente para que la estimación signifique algo
+    bool ready() const { return decimatedCount >= historyNeeded; }
+
+  private:
+    void pushDecimated(float x);
+    void estimate();
+
+    uint8_t decimation = 1;
+    float decimatedRate = DECIMATED_RATE_HZ;
+    size_t minLag = 0;
+    size_t maxLag = 0;
+    float forget = 1;
+    uint32_t historyNeeded = 0;
+
+    uint64_t accumulator = 0; // Hasta 8 módulos² de 32 bits
+    uint8_t accumulated = 0;
+    float mean = 0;
+    bool meanStarted = false;
+
+    // history[MAX_LAG - 1] es la muestra más reciente; se desplaza una posición por muestra
+    float history[MAX_LAG];
+    float corr[MAX_LAG + 1];
+    uint32_t decimatedCount = 0;
+    uint8_t sinceEstimate = 0;
+
+    uint32_t period = 0;
+    float conf = 0;
+};
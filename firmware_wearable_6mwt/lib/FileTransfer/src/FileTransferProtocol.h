@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Protocolo de descarga de ficheros (sesiones grabadas) por BLE.
+//
+// El servicio tiene dos características: el punto de control (escritura y
+// notificación) para peticiones y respuestas, y la de datos (notificación) para los
+// fragmentos. Todos los campos son little-endian.
+//
+// Peticiones (escritas en el punto de control):
+//   LIST    0x01  uint16 primer índice
+//   READ    0x02  uint16 id, uint32 desde (offset), uint32 longitud (0 = hasta el final),
+//                 uint16 créditos iniciales
+//   CREDIT  0x03  uint16 créditos que se suman
+//   ABORT   0x04  cancela la lectura en curso
+//
+// Respuestas (notificadas en el punto de control): código | 0x80, uint8 estado, y
+//   LIST    uint16 primer índice, uint16 ficheros en total, uint8 n, y n veces
+//           uint16 id, uint32 tamaño, uint8 flags (bit 0: grabación en curso)
+//   READ    uint16 id, uint32 desde, uint32 fin (exclusivo), uint16 bytes de datos por fragmento
+//   DONE    (0x85) uint16 id, uint32 fin: ya se envió el último fragmento
+// Con estado distinto de OK la respuesta se queda en el estado.
+//
+// Fragmentos (notificados en la de datos):
+//   uint32 offset, uint16 CRC-16/CCITT-FALSE del offset y los datos, datos
+//
+// Control de flujo por créditos: cada fragmento gasta un crédito y el servidor se
+// detiene al agotarlos, así que el cliente limita lo que hay en vuelo devolviéndolos a
+// medida que consume. Si falta un fragmento o su CRC no cuadra, el cliente hace ABORT
+// y un READ desde el último offset correcto; lo mismo para reanudar tras reconectar.
+enum FileTransferOpcode : uint8_t {
+  FT_OP_LIST = 0x01,
+  FT_OP_READ = 0x02,
+  FT_OP_CREDIT = 0x03,
+  FT_OP_ABORT = 0x04,
+  FT_OP_DONE = 0x05 // Solo como respuesta (0x85)
+};
+
+const uint8_t FT_RESPONSE = 0x80;
+
+enum FileTransferStatus : uint8_t {
+  FT_OK = 0,
+  FT_BAD_REQUEST = 1,
+  FT_NOT_FOUND = 2,
+  FT_BAD_RANGE = 3,
+  FT_IO_ERROR = 4
+};
+
+const uint8_t FT_FLAG_RECORDING = 0x01;
+
+const size_t FT_MAX_REQUEST_SIZE = 13;
+const size_t FT_LIST_HEADER_SIZE = 7;
+const size_t FT_LIST_ENTRY_SIZE = 7;
+const size_t FT_READ_RESPONSE_SIZE = 14;
+const size_t FT_DONE_SIZE = 8;
+const size_t FT_CHUNK_HEADER_SIZE = 6;
+
+// CRC-16/CCITT-FALSE (polinomio 0x1021, inicial 0xFFFF) con tabla de 16 entradas:
+// medio byte por paso, sin los 512 bytes de la tabla completa
+inline uint16_t crc16Update(uint16_t crc, const uint8_t *data, size_t len) {
+  static const uint16_t TABLE[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+  for (size_t i = 0; i < len; i++) {
+    crc = (uint16_t)((crc << 4) ^ TABLE[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ TABLE[(crc >> 12) ^ (data[i] & 0x0F)]);
+  }
+  return crc;
+}
+
+inline uint16_t crc16(const uint8_t *data, size_t len) {
+  return crc16Update(0xFFFF, data, len);
+}
@@ -0,0 +1,152 @@
+#include "FileTransferServer.h"
+#include <string.h>
+#include <ByteOrder.h>
+
+bool FileTransferServer::enqueue(const uint8_t *request, size_t len) {
+  if (len == 0 || len > FT_MAX_REQUEST_SIZE) return false;
+  Request r;
+  r.len = (uint8_t)len;
+  memcpy(r.data, request, len);
+  return requests.push(r);
+}
+
+bool FileTransferServer::service(size_t maxChunks) {
+  Request request;
+  while (requests.pop(request)) handle(request);
+
+  size_t sent = 0;
+  while (active && credits > 0 && sent < maxChunks) {
+    size_t n = end - position < payloadSize ? end - position : payloadSize;
+    if (store.read(position, packet + FT_CHUNK_HEADER_SIZE, n) != n) {
+      sendStatus(FT_OP_READ, FT_IO_ERROR);
+      store.close();
+      active = false;
+      break;
+    }
+    putLe32(packet, position);
+    uint16_t crc = crc16Update(crc16(packet, 4), packet + FT_CHUNK_HEADER_SIZE, n);
+    putLe16(packet + 4, crc);
+    if (!link.sendData(packet, FT_CHUNK_HEADER_SIZE + n)) break;
+
+    position += n;
+    credits--;
+    sent++;
+    sentChunks++;
+    if (position >= end) finish();
+  }
+  return active && credits > 0;
+}
+
+void FileTransferServer::handle(const Request &request) {
+  const uint8_t *data = request.data;
+  switch (data[0]) {
+    case FT_OP_LIST:
+      handleList(data, request.len);
+      break;
+    case FT_OP_READ:
+      handleRead(data, request.len);
+      break;
+    case FT_OP_CREDIT:
+      if (request.len == 3) credits += getLe16(data + 1);
+      break;
+    case FT_OP_ABORT:
+      if (active) store.close();
+      active = false;
+      credits = 0;
+      break;
+    default:
+      sendStatus(data[0], FT_BAD_REQUEST);
+      break;
+  }
+}
+
+// Tantas entradas como quepan en una notificación; el cliente pide la siguiente página
+void FileTransferServer::handleList(const uint8_t *data, size_t len) {
+  if (len != 3) {
+    sendStatus(FT_OP_LIST, FT_BAD_REQUEST);
+    return;
+  }
+  uint16_t first = getLe16(data + 1);
+  // La lista se rehace al empezar por el principio y se mantiene mientras se pagina
+  if (first == 0) listed = store.refresh();
+
+  size_t room = link.maxPacket();
+  if (room > MAX_PACKET_SIZE) room = MAX_PACKET_SIZE;
+  size_t capacity = (room - FT_LIST_HEADER_SIZE) / FT_LIST_ENTRY_SIZE;
+  uint8_t *p = packet + FT_LIST_HEADER_SIZE;
+  uint8_t count = 0;
+  for (size_t i = first; i < listed && count < capacity; i++) {
+    FileInfo file;
+    if (!store.info(i, file)) break;
+    putLe16(p, file.id);
+    putLe32(p + 2, file.size);
+    p[6] = file.flags;
+    p += FT_LIST_ENTRY_SIZE;
+    count++;
+  }
+  packet[0] = FT_OP_LIST | FT_RESPONSE;
+  packet[1] = FT_OK;
+  putLe16(packet + 2, first);
+  putLe16(packet + 4, (uint16_t)listed);
+  packet[6] = count;
+  link.sendControl(packet, FT_LIST_HEADER_SIZE + count * FT_LIST_ENTRY_SIZE);
+}
+
+void FileTransferServer::handleRead(const uint8_t *data, size_t len) {
+  if (len != 13) {
+    sendStatus(FT_OP_READ, FT_BAD_REQUEST);
+    return;
+  }
+  if (active) store.close();
+  active = false;
+
+  uint16_t id = getLe16(data + 1);
+  uint32_t from = getLe32(data + 3);
+  uint32_t length = getLe32(data + 7);
+  uint32_t size = 0;
+  if (!store.open(id, size)) {
+    sendStatus(FT_OP_READ, FT_NOT_FOUND);
+    return;
+  }
+  if (from > size || (length > 0 && length > size - from)) {
+    store.close();
+    sendStatus(FT_OP_READ, FT_BAD_RANGE);
+    return;
+  }
+
+  fileId = id;
+  position = from;
+  end = length > 0 ? from + length : size;
+  credits = getLe16(data + 11);
+  // El tamaño de fragmento se fija para toda la lectura con el MTU de ese momento
+  size_t room = link.maxPacket();
+  if (room > MAX_PACKET_SIZE) room = MAX_PACKET_SIZE;
+  payloadSize = room - FT_CHUNK_HEADER_SIZE;
+  active = true;
+
+  uint8_t response[FT_READ_RESPONSE_SIZE];
+  response[0] = FT_OP_READ | FT_RESPONSE;
+  response[1] = FT_OK;
+  putLe16(response + 2, fileId);
+  putLe32(response + 4, position);
+  putLe32(response + 8, end);
+  putLe16(response + 12, (uint16_t)payloadSize);
+  link.sendControl(response, sizeof(response));
+  if (position >= end) finish();
+}
+
+void FileTransferServer::sendStatus(uint8_t opcode, FileTransferStatus status) {
+  uint8_t response[2] = {(uint8_t)(opcode | FT_RESPONSE), status};
+  link.sendControl(response, sizeof(response));
+}
+
+void FileTransferServer::finish() {
+  uint8_t response[FT_DONE_SIZE];
+  response[0] = FT_OP_DONE | FT_RESPONSE;
+  response[1] = FT_OK;
+  putLe16(response + 2, fileId);
+  putLe32(response + 4, end);
+  link.sendControl(response, sizeof(response));
+  store.close();
+  active = false;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <SpscRing.h>
+#include "FileTransferProtocol.h"
+
+struct FileInfo {
+  uint16_t id;
+  uint32_t size;
+  uint8_t flags;
+};
+
+// Ficheros que sirve el servidor (en el firmware, las sesiones de LittleFS)
+class FileTransferStore {
+  public:
+    virtual ~FileTransferStore() {}
+    // Rehace la lista de ficheros y devuelve cuántos hay; info() recorre esa lista
+    virtual size_t refresh() = 0;
+    virtual bool info(size_t index, FileInfo &out) = 0;
+    // Solo hay un fichero abierto a la vez
+    virtual bool open(uint16_t id, uint32_t &size) = 0;
+    virtual size_t read(uint32_t offset, uint8_t *out, size_t len) = 0;
+    virtual void close() = 0;
+};
+
+// Salida hacia el cliente (en el firmware, notificaciones BLE)
+class FileTransferLink {
+  public:
+    virtual ~FileTransferLink() {}
+    // Bytes por notificación con el MTU actual (MTU - 3)
+    virtual size_t maxPacket() = 0;
+    virtual bool sendControl(const uint8_t *data, size_t len) = 0;
+    // false si el enlace no admite más por ahora: el fragmento se reintenta
+    virtual bool sendData(const uint8_t *data, size_t len) = 0;
+};
+
+// Servidor del protocolo de FileTransferProtocol.h.
+//
+// Las peticiones llegan desde el contexto del stack BLE y solo se copian a una cola;
+// todo el trabajo (listar, leer la flash, notificar) lo hace service() desde una única
+// tarea. No depende de Arduino, así que el mismo código se prueba en el host con un
+// transporte simulado (tools/transfer).
+class FileTransferServer {
+  public:
+    static const size_t MAX_PACKET_SIZE = 244;
+
+    FileTransferServer(FileTransferStore &store, FileTransferLink &link) : store(store), link(link) {}
+
+    // Productor (callback de escritura): false si la petición no cabe o la cola está llena
+    bool enqueue(const uint8_t *request, size_t len);
+
+    // Atiende peticiones y envía hasta maxChunks fragmentos. Devuelve true si queda
+    // trabajo que no depende del cliente (más fragmentos con créditos disponibles).
+    bool service(size_t maxChunks);
+
+    bool reading() const { return active; }
+    uint32_t chunksSent() const { return sentChunks; }
+
+  private:
+    struct Request {
+      uint8_t len;
+      uint8_t data[FT_MAX_REQUEST_SIZE];
+    };
+
+    void handle(const Request &request);
+    void handleList(const uint8_t *data, size_t len);
+    void handleRead(const uint8_t *data, size_t len);
+    void sendStatus(uint8_t opcode, FileTransferStatus status);
+    void finish();
+
+    FileTransferStore &store;
+    FileTransferLink &link;
+    SpscRing<Request, 8> requests;
+
+    size_t listed = 0;
+    bool active = false;
+    uint16_t fileId = 0;
+    uint32_t position = 0;
+    uint32_t end = 0;
+    uint32_t credits = 0;
+    size_t payloadSize = 0;
+    uint32_t sentChunks = 0;
+    uint8_t packet[MAX_PACKET_SIZE];
+};
@@ -0,0 +1,119 @@
+#include "GravityEstimator.h"
+
+#include <math.h>
+
+GravityEstimator::GravityEstimator(double sampleRateHz) {
+  setSampleRate(sampleRateHz);
+}
+
+void GravityEstimator::setSampleRate(double sampleRateHz) {
+  dt = (float)(1.0 / sampleRateHz);
+  alpha = dt / GRAVITY_SECONDS;
+  reset();
+}
+
+uint32_t GravityEstimator::verticalSq(const RawSample &a, const RawGyroSample *gyro) {
+  if (!started) {
+    gx = a.x;
+    gy = a.y;
+    gz = a.z;
+    started = true;
+  }
+
+  if (gyro != NULL) {
+    // Un vector fijo en el mundo, visto desde el sensor que gira: dg/dt = g x w
+    float k = GYRO_RAD_PER_COUNT_500 * dt;
+    float wx = gyro->x * k, wy = gyro->y * k, wz = gyro->z * k;
+    float rx = gy * wz - gz * wy;
+    float ry = gz * wx - gx * wz;
+    float rz = gx * wy - gy * wx;
+    gx += rx;
+    gy += ry;
+    gz += rz;
+  }
+  gx += (a.x - gx) * alpha;
+  gy += (a.y - gy) * alpha;
+  gz += (a.z - gz) * alpha;
+
+  float norm = sqrtf(gx * gx + gy * gy + gz * gz);
+  if (norm <= 0) return magnitudeSquared(a);
+  float v = (a.x * gx + a.y * gy + a.z * gz) / norm;
+  // Solo cuenta la vertical hacia arriba: por debajo de cero no hay paso que detectar
+  if (v <= 0) return 0;
+  float sq = v * v;
+  return sq >= 4294967295.0F ? UINT32_MAX : (uint32_t)sq;
+}
+
+// Raíz cuadrada entera por dígitos binarios: se usa una vez cada NORMALIZE_EVERY muestras
+static uint32_t isqrt64(uint64_t x) {
+  uint64_t result = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > x) bit >>= 2;
+  while (bit != 0) {
+    if (x >= result + bit) {
+      x -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+GravityEstimatorQ::GravityEstimatorQ(double sampleRateHz) {
+  setSampleRate(sampleRateHz);
+}
+
+void GravityEstimatorQ::setSampleRate(double sampleRateHz) {
+  rotPerCount = (int32_t)(GYRO_RAD_PER_COUNT_500 / sampleRateHz * (double)(1L << ROT_FRAC) + 0.5);
+  // La constante de tiempo se redondea a una potencia de dos muestras
+  alphaShift = 1;
+  while (alphaShift < 16 && (double)(1UL << (alphaShift + 1)) <= sampleRateHz * GravityEstimator::GRAVITY_SECONDS) {
+    alphaShift++;
+  }
+  reset();
+}
+
+void GravityEstimatorQ::normalize() {
+  int64_t n2 = (int64_t)g[0] * g[0] + (int64_t)g[1] * g[1] + (int64_t)g[2] * g[2];
+  uint32_t n = isqrt64((uint64_t)n2);
+  if (n == 0) return;
+  for (int i = 0; i < 3; i++) {
+    unit[i] = (int32_t)(((int64_t)g[i] << UNIT_FRAC) / n);
+  }
+}
+
+uint32_t GravityEstimatorQ::verticalSq(const RawSample &a, const RawGyroSample *gyro) {
+  const int32_t ax[3] = {a.x, a.y, a.z};
+
+  if (!started) {
+    for (int i = 0; i < 3; i++) g[i] = ax[i] * (1 << G_FRAC);
+    normalize();
+    sinceNormalize = 0;
+    started = true;
+  }
+
+  if (gyro != NULL) {
+    // g += g x w, con w en "radianes por muestra" Q30
+    const int32_t w[3] = {gyro->x, gyro->y, gyro->z};
+    int64_t rx = (int64_t)g[1] * w[2] - (int64_t)g[2] * w[1];
+    int64_t ry = (int64_t)g[2] * w[0] - (int64_t)g[0] * w[2];
+    int64_t rz = (int64_t)g[0] * w[1] - (int64_t)g[1] * w[0];
+    g[0] += (int32_t)((rx * rotPerCount) >> ROT_FRAC);
+    g[1] += (int32_t)((ry * rotPerCount) >> ROT_FRAC);
+    g[2] += (int32_t)((rz * rotPerCount) >> ROT_FRAC);
+  }
+  for (int i = 0; i < 3; i++) {
+    g[i] += ((ax[i] * (1 << G_FRAC)) - g[i]) >> alphaShift;
+  }
+
+  if (++sinceNormalize >= NORMALIZE_EVERY) {
+    sinceNormalize = 0;
+    normalize();
+  }
+
+  int32_t v = (ax[0] * unit[0] + ax[1] * unit[1] + ax[2] * unit[2]) >> UNIT_FRAC;
+  if (v <= 0) return 0;
+  return (uint32_t)v * (uint32_t)v;
+}
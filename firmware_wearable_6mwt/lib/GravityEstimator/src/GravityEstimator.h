@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <RawSample.h>
+
+// Estimación de la gravedad para proyectar la aceleración sobre la vertical.
+//
+// Filtro complementario: la estimación anterior se gira con el giroscopio (si lo hay)
+// y se mezcla con el acelerómetro con una constante de tiempo de GRAVITY_SECONDS.
+// Sin giroscopio queda en una media lenta del acelerómetro. La salida es la componente
+// vertical al cuadrado, en cuentas², para entrar al detector en lugar del módulo²: la
+// gravedad que se reparte entre ejes al inclinarse el wearable en el cinturón ya no
+// desplaza los umbrales.
+//
+// Hay dos variantes con la misma interfaz: GravityEstimator en float (una raíz por
+// muestra) y GravityEstimatorQ en enteros (la normalización, con raíz entera, se
+// rehace cada NORMALIZE_EVERY muestras). Ninguna usa heap ni depende de Arduino.
+
+// Giroscopio del LSM9DS1 a ±500 dps (17.50 mdps/LSB) en rad/s por cuenta
+constexpr float GYRO_RAD_PER_COUNT_500 = 0.0175F * 3.14159265F / 180.0F;
+
+class GravityEstimator {
+  public:
+    static constexpr float GRAVITY_SECONDS = 1.0F;
+
+    explicit GravityEstimator(double sampleRateHz);
+
+    void setSampleRate(double sampleRateHz);
+    void reset() { started = false; }
+
+    // Actualiza con una muestra (gyro puede ser NULL) y devuelve la vertical²
+    uint32_t verticalSq(const RawSample &accel, const RawGyroSample *gyro);
+
+  private:
+    float dt = 0;
+    float alpha = 0;
+    float gx = 0, gy = 0, gz = 0;
+    bool started = false;
+};
+
+class GravityEstimatorQ {
+  public:
+    static const uint8_t NORMALIZE_EVERY = 16;
+
+    explicit GravityEstimatorQ(double sampleRateHz);
+
+    void setSampleRate(double sampleRateHz);
+    void reset() { started = false; }
+
+    uint32_t verticalSq(const RawSample &accel, const RawGyroSample *gyro);
+
+  private:
+    static const int G_FRAC = 8;     // Gravedad en cuentas Q8
+    static const int UNIT_FRAC = 14; // Vector unitario en Q14
+    static const int ROT_FRAC = 30;  // Giro por cuenta de giroscopio y muestra en Q30
+
+    void normalize();
+
+    int32_t rotPerCount = 0;
+    uint8_t alphaShift = 1;
+    int32_t g[3] = {0, 0, 0};
+    int32_t unit[3] = {0, 0, 0};
+    uint8_t sinceNormalize = 0;
+    bool started = false;
+};
@@ -0,0 +1,112 @@
+#include "HistoryBuffer.h"
+#include <string.h>
+#include <ByteOrder.h>
+
+void HistoryBuffer::attach(HistoryEntry *storage, size_t capacity, bool external) {
+  entries = storage;
+  cap = storage != NULL ? capacity : 0;
+  externalMemory = external;
+  clear();
+}
+
+void HistoryBuffer::clear() {
+  written.store(0, std::memory_order_release);
+}
+
+uint32_t HistoryBuffer::begin() const {
+  uint32_t n = end();
+  return n > cap ? n - (uint32_t)cap : 0;
+}
+
+// copyIn() escribe hasta BLOCK entradas antes de publicarlas en 'written': las BLOCK
+// más antiguas pueden estar a medio sobrescribir aunque begin() todavía las incluya
+uint32_t HistoryBuffer::firstStable() const {
+  uint32_t n = end() + (uint32_t)BLOCK;
+  return n > cap ? n - (uint32_t)cap : 0;
+}
+
+void HistoryBuffer::append(const RawSample *samples, const uint32_t *signalSq, size_t n) {
+  if (entries == NULL) return;
+  HistoryEntry block[BLOCK];
+  while (n > 0) {
+    size_t chunk = n < BLOCK ? n : BLOCK;
+    for (size_t i = 0; i < chunk; i++) {
+      block[i].t_ms = samples[i].t_ms;
+      block[i].x = samples[i].x;
+      block[i].y = samples[i].y;
+      block[i].z = samples[i].z;
+      block[i].flags = 0;
+      block[i].reserved = 0;
+      block[i].signalSq = signalSq[i];
+    }
+    copyIn(block, chunk);
+    samples += chunk;
+    signalSq += chunk;
+    n -= chunk;
+  }
+}
+
+// Una o dos copias contiguas según caiga el final del anillo
+void HistoryBuffer::copyIn(const HistoryEntry *block, size_t n) {
+  uint32_t index = written.load(std::memory_order_relaxed);
+  size_t slot = index % cap;
+  size_t first = cap - slot < n ? cap - slot : n;
+  memcpy(&entries[slot], block, first * sizeof(HistoryEntry));
+  if (first < n) memcpy(&entries[0], block + first, (n - first) * sizeof(HistoryEntry));
+  written.store(index + (uint32_t)n, std::memory_order_release);
+}
+
+void HistoryBuffer::markStep(uint32_t t_ms) {
+  if (entries == NULL) return;
+  uint32_t last = end();
+  uint32_t first = begin();
+  for (uint32_t i = last; i > first && last - i < BLOCK; i--) {
+    HistoryEntry &e = entries[(i - 1) % cap];
+    if (e.t_ms == t_ms) {
+      e.flags |= HISTORY_STEP;
+      return;
+    }
+  }
+}
+
+size_t HistoryBuffer::read(uint32_t from, HistoryEntry *out, size_t n) const {
+  if (entries == NULL) return 0;
+  uint32_t last = end();
+  if (from < firstStable() || from >= last) return 0;
+  if (n > last - from) n = last - from;
+
+  size_t slot = from % cap;
+  size_t first = cap - slot < n ? cap - slot : n;
+  memcpy(out, &entries[slot], first * sizeof(HistoryEntry));
+  if (first < n) memcpy(out + first, &entries[0], (n - first) * sizeof(HistoryEntry));
+  // Las lecturas de la copia no pueden pasar a después de volver a leer 'written'
+  std::atomic_thread_fence(std::memory_order_acquire);
+  // Si el escritor dio la vuelta mientras se copiaba, lo copiado ya no es fiable
+  if (from < firstStable()) return 0;
+  return n;
+}
+
+uint32_t HistoryBuffer::indexAtTime(uint32_t t_ms) const {
+  uint32_t lo = begin();
+  uint32_t hi = end();
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if ((int32_t)(entries[mid % cap].t_ms - t_ms) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void HistoryBuffer::writeDiagnostics(TlvWriter &out) const {
+  uint8_t *p = out.section(DIAG_TAG_HISTORY, 13);
+  if (p == NULL) return;
+  uint32_t first = begin();
+  uint32_t last = end();
+  putLe32(p, (uint32_t)cap);
+  putLe32(p + 4, last - first);
+  putLe32(p + 8, last > first ? entries[first % cap].t_ms : 0);
+  p[12] = externalMemory ? 1 : 0;
+}
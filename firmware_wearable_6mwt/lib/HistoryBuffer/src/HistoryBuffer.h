@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <RawSample.h>
+#include <TlvWriter.h>
+
+// Entrada del historial: la muestra cruda, la señal que recibió el detector y si el
+// detector en vivo contó un paso en ella. 16 bytes: dos entradas por línea de caché.
+struct HistoryEntry {
+  uint32_t t_ms;
+  int16_t x;
+  int16_t y;
+  int16_t z;
+  uint8_t flags;
+  uint8_t reserved;
+  uint32_t signalSq; // Entrada del detector (módulo² o vertical²) sin filtrar
+};
+
+static_assert(sizeof(HistoryEntry) == 16, "HistoryEntry debe ocupar 16 bytes");
+
+const uint8_t HISTORY_STEP = 0x01;
+
+// Historial circular de los últimos minutos de muestras, para reprocesar la prueba
+// entera después sin la tablet.
+//
+// La memoria la pone quien lo usa (en el firmware, la PSRAM externa): el historial
+// solo guarda el puntero. A la PSRAM se accede a través de la caché, así que tanto la
+// escritura como la lectura van por bloques: el escritor monta cada bloque en SRAM y
+// lo copia de una vez, y el lector copia a SRAM bloques contiguos. El estado caliente
+// del detector no vive aquí, sigue en la SRAM interna.
+//
+// Los índices son absolutos (número de entradas escritas desde clear()): la entrada i
+// está en i % capacity mientras i >= begin(). Un único escritor; un lector en otra
+// tarea comprueba con begin() tras copiar que lo copiado no se sobrescribió entretanto.
+// No depende de Arduino.
+class HistoryBuffer {
+  public:
+    // Entradas que se montan en SRAM antes de copiarlas (512 bytes)
+    static const size_t BLOCK = 32;
+
+    void attach(HistoryEntry *storage, size_t capacity, bool external);
+    bool attached() const { return entries != NULL; }
+
+    // Escritor: añade n muestras con su señal²
+    void append(const RawSample *samples, const uint32_t *signalSq, size_t n);
+    // Escritor: marca el paso detectado en la muestra con ese instante (entre las
+    // últimas BLOCK entradas)
+    void markStep(uint32_t t_ms);
+    void clear();
+
+    uint32_t begin() const;
+    uint32_t end() const { return written.load(std::memory_order_acquire); }
+    size_t capacity() const { return cap; }
+
+    // Lector: copia hasta n entradas desde el índice absoluto 'from'; devuelve las copiadas
+    // (0 si 'from' ya se sobrescribió, está entre las BLOCK que el escritor puede estar
+    // sobrescribiendo o no existe todavía)
+    size_t read(uint32_t from, HistoryEntry *out, size_t n) const;
+
+    // Primer índice con t_ms >= instante (búsqueda binaria sobre el historial)
+    uint32_t indexAtTime(uint32_t t_ms) const;
+
+    // Añade la sección DIAG_TAG_HISTORY: capacidad, entradas guardadas, t_ms de la más
+    // antigua y si la memoria es externa
+    void writeDiagnostics(TlvWriter &out) const;
+
+  private:
+    void copyIn(const HistoryEntry *block, size_t n);
+    uint32_t firstStable() const;
+
+    HistoryEntry *entries = NULL;
+    size_t cap = 0;
+    bool externalMemory = false;
+    std::atomic<uint32_t> written{0};
+};
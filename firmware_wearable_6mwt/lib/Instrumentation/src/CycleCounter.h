@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// Contador de ciclos del núcleo que ejecuta la llamada (CCOUNT en Xtensa, 32 bits:
+// da la vuelta cada ~18 s a 240 MHz, así que solo sirve para intervalos cortos). En el
+// host se sustituye por nanosegundos de un reloj monótono, como si la CPU fuese a 1 GHz.
+#if defined(__XTENSA__)
+#include <xtensa/hal.h>
+
+inline uint32_t cycleCount() { return xthal_get_ccount(); }
+#else
+#include <chrono>
+
+inline uint32_t cycleCount() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
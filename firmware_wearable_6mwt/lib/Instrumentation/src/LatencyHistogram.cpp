@@ -0,0 +1,50 @@
+#include "LatencyHistogram.h"
+#include <math.h>
+
+size_t LatencyHistogram::bucketOf(uint32_t value) {
+  if (value < SUBS) return value;
+  uint8_t octave = 31 - __builtin_clz(value);
+  uint32_t sub = (value >> (octave - SUB_BITS)) & (SUBS - 1);
+  return (size_t)(octave - SUB_BITS + 1) * SUBS + sub;
+}
+
+uint32_t LatencyHistogram::bucketLow(size_t bucket) {
+  if (bucket < SUBS) return (uint32_t)bucket;
+  uint8_t octave = (uint8_t)(bucket / SUBS + SUB_BITS - 1);
+  uint32_t sub = bucket % SUBS;
+  return (1UL << octave) + (sub << (octave - SUB_BITS));
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t perMille) const {
+  if (total == 0) return 0;
+  uint64_t target = ((uint64_t)total * perMille + 999) / 1000;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += counts[i];
+    if (seen >= target) {
+      uint32_t high = i + 1 < BUCKETS ? bucketLow(i + 1) - 1 : UINT32_MAX;
+      return high < maxValue ? high : maxValue;
+    }
+  }
+  return maxValue;
+}
+
+void LatencyHistogram::clear() {
+  for (size_t i = 0; i < BUCKETS; i++) counts[i] = 0;
+  total = 0;
+  minValue = 0;
+  maxValue = 0;
+  resetPending.store(false, std::memory_order_relaxed);
+}
+
+uint32_t JitterMeter::rmsUs() const {
+  return samples > 0 ? (uint32_t)(sqrt((double)sumSq / samples) + 0.5) : 0;
+}
+
+void JitterMeter::clear() {
+  samples = 0;
+  minDev = 0;
+  maxDev = 0;
+  sumSq = 0;
+  resetPending.store(false, std::memory_order_relaxed);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Histograma log-lineal de latencias (en ciclos o en µs, según quien registre).
+//
+// Cada potencia de dos se parte en SUBS cubos iguales, así que el error relativo de un
+// cubo es como mucho 1 / SUBS (25 %) en todo el rango de 32 bits, con 124 contadores
+// fijos y sin heap. Los valores menores que SUBS tienen un cubo cada uno.
+//
+// Un único escritor (la tarea de la etapa medida). Un lector en otra tarea puede ver
+// los contadores a medio actualizar, lo que solo descuadra un registro. reset() desde
+// otra tarea solo lo pide: lo aplica el escritor en su siguiente record().
+class LatencyHistogram {
+  public:
+    static const uint8_t SUB_BITS = 2;
+    static const uint32_t SUBS = 1 << SUB_BITS;
+    static const size_t BUCKETS = (32 - SUB_BITS + 1) * SUBS;
+
+    void record(uint32_t value) {
+      if (resetPending.load(std::memory_order_acquire)) clear();
+      counts[bucketOf(value)]++;
+      if (total == 0 || value < minValue) minValue = value;
+      if (value > maxValue) maxValue = value;
+      total++;
+    }
+
+    void reset() { resetPending.store(true, std::memory_order_release); }
+
+    uint32_t count() const { return total; }
+    uint32_t min() const { return minValue; }
+    uint32_t max() const { return maxValue; }
+    uint32_t at(size_t bucket) const { return counts[bucket]; }
+
+    // Valor por debajo del cual queda la fracción perMille de los registros (el límite
+    // superior de su cubo, acotado por el máximo visto); 0 si no hay registros
+    uint32_t percentile(uint32_t perMille) const;
+
+    static size_t bucketOf(uint32_t value);
+    // Menor valor que cae en el cubo
+    static uint32_t bucketLow(size_t bucket);
+
+  private:
+    void clear();
+
+    uint32_t counts[BUCKETS] = {0};
+    uint32_t total = 0;
+    uint32_t minValue = 0;
+    uint32_t maxValue = 0;
+    std::atomic<bool> resetPending{false};
+};
+
+// Desviación del intervalo real entre muestras respecto al nominal, en µs: histograma
+// de la desviación absoluta y extremos y media cuadrática con signo
+class JitterMeter {
+  public:
+    void record(uint32_t actualUs, uint32_t expectedUs) {
+      if (resetPending.load(std::memory_order_acquire)) clear();
+      int32_t deviation = (int32_t)(actualUs - expectedUs);
+      histogram.record((uint32_t)(deviation < 0 ? -deviation : deviation));
+      if (samples == 0 || deviation < minDev) minDev = deviation;
+      if (samples == 0 || deviation > maxDev) maxDev = deviation;
+      sumSq += (int64_t)deviation * deviation;
+      nominalUs = expectedUs;
+      samples++;
+    }
+
+    void reset() {
+      histogram.reset();
+      resetPending.store(true, std::memory_order_release);
+    }
+
+    const LatencyHistogram &deviations() const { return histogram; }
+    uint32_t count() const { return samples; }
+    int32_t minDeviationUs() const { return minDev; }
+    int32_t maxDeviationUs() const { return maxDev; }
+    uint32_t expectedUs() const { return nominalUs; }
+    uint32_t rmsUs() const;
+
+  private:
+    void clear();
+
+    LatencyHistogram histogram;
+    uint32_t samples = 0;
+    int32_t minDev = 0;
+    int32_t maxDev = 0;
+    uint64_t sumSq = 0;
+    uint32_t nominalUs = 0;
+    std::atomic<bool> resetPending{false};
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Valor de la característica de tiempos.
+//
+// Escritura (1 byte): índice de la etapa que devolverán las lecturas siguientes (el
+// valor TIMING_STAGES del firmware, el número de etapas, selecciona el jitter), o
+// TIMING_RESET para vaciar todos los histogramas. Cualquier otro valor se ignora.
+// Lectura (little-endian), versión 1:
+//   uint8 versión, uint8 seleccionado, uint8 nº de etapas, uint8 SUB_BITS del histograma,
+//   uint16 MHz de la CPU, uint16 ciclos de sobrecarga por medida,
+//   uint32 registros, uint32 mínimo, uint32 máximo,
+//   uint8 nº de cubos no vacíos, y por cada uno uint8 cubo y uint32 registros.
+// Las etapas están en ciclos y el jitter en µs de desviación absoluta. El cubo i con
+// i < 2^SUB_BITS vale i; si no, empieza en 2^o + s * 2^(o - SUB_BITS) con
+// o = i / 2^SUB_BITS + SUB_BITS - 1 y s = i % 2^SUB_BITS. Caben hasta 98 cubos en los
+// 512 bytes de un atributo (lectura larga).
+const uint8_t TIMING_RESET = 0xFF;
+
+const uint8_t TIMING_PACKET_VERSION = 1;
+const size_t TIMING_HEADER_SIZE = 21;
+const size_t TIMING_BUCKET_SIZE = 5;
+const size_t TIMING_MAX_PACKET_SIZE = 512;
@@ -0,0 +1,78 @@
+#include "TimingProfile.h"
+#include <ByteOrder.h>
+#include "TimingPacket.h"
+
+void TimingProfile::calibrate() {
+  const int ROUNDS = 32;
+  uint32_t bias = UINT32_MAX;
+  uint32_t cost = UINT32_MAX;
+  LatencyHistogram scratch;
+  for (int i = 0; i < ROUNDS; i++) {
+    uint32_t start = cycleCount();
+    uint32_t read = cycleCount() - start;
+    if (read < bias) bias = read;
+
+    start = cycleCount();
+    scratch.record(read);
+    uint32_t recorded = cycleCount() - start;
+    if (recorded < cost) cost = recorded;
+  }
+  biasCycles = bias;
+  // El mínimo de varias vueltas quita las interrupciones que cayeran en medio
+  recordCost = cost > bias ? cost - bias : 0;
+}
+
+void TimingProfile::reset() {
+  for (size_t i = 0; i < stageCount; i++) stageHistograms[i].reset();
+  jitterMeter.reset();
+}
+
+static uint16_t saturate16(uint32_t value) {
+  return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+void TimingProfile::writeDiagnostics(TlvWriter &out) const {
+  uint8_t *p = out.section(DIAG_TAG_TIMING, (uint8_t)(4 + stageCount * 6 + 4));
+  if (p == NULL) return;
+  putLe16(p, mhz);
+  putLe16(p + 2, saturate16(biasCycles + recordCost));
+  p += 4;
+  for (size_t i = 0; i < stageCount; i++) {
+    const LatencyHistogram &h = stageHistograms[i];
+    putLe16(p, saturate16(toUs(h.percentile(500))));
+    putLe16(p + 2, saturate16(toUs(h.percentile(990))));
+    putLe16(p + 4, saturate16(toUs(h.max())));
+    p += 6;
+  }
+  int32_t worst = -jitterMeter.minDeviationUs() > jitterMeter.maxDeviationUs()
+      ? -jitterMeter.minDeviationUs() : jitterMeter.maxDeviationUs();
+  putLe16(p, saturate16(jitterMeter.rmsUs()));
+  putLe16(p + 2, saturate16((uint32_t)worst));
+}
+
+size_t TimingProfile::packHistogram(uint8_t *out, size_t capacity, uint8_t selected) const {
+  if (capacity < TIMING_HEADER_SIZE) return 0;
+  const LatencyHistogram &h = selected < stageCount ? stageHistograms[selected] : jitterMeter.deviations();
+  out[0] = TIMING_PACKET_VERSION;
+  out[1] = selected < stageCount ? selected : (uint8_t)stageCount;
+  out[2] = (uint8_t)stageCount;
+  out[3] = LatencyHistogram::SUB_BITS;
+  putLe16(out + 4, mhz);
+  putLe16(out + 6, saturate16(biasCycles + recordCost));
+  putLe32(out + 8, h.count());
+  putLe32(out + 12, h.min());
+  putLe32(out + 16, h.max());
+  size_t len = TIMING_HEADER_SIZE;
+  uint8_t buckets = 0;
+  for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+    uint32_t n = h.at(i);
+    if (n == 0) continue;
+    if (len + TIMING_BUCKET_SIZE > capacity) break;
+    out[len] = (uint8_t)i;
+    putLe32(out + len + 1, n);
+    len += TIMING_BUCKET_SIZE;
+    buckets++;
+  }
+  out[20] = buckets;
+  return len;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <TlvWriter.h>
+#include "CycleCounter.h"
+#include "LatencyHistogram.h"
+
+// Tiempos por etapa (en ciclos) y jitter del intervalo entre muestras, sin heap.
+//
+// Una medida es la diferencia de dos lecturas del contador de ciclos más un record():
+// calibrate() mide ambas cosas al arrancar. El coste de las dos lecturas seguidas se
+// descuenta de cada medida y el de record() queda publicado como sobrecarga por medida,
+// para saber cuánto tiempo se llevan las propias medidas.
+class TimingProfile {
+  public:
+    static const size_t MAX_STAGES = 8;
+
+    TimingProfile(const char *const *stageNames, size_t stages, uint16_t cpuMhz)
+        : names(stageNames), stageCount(stages < MAX_STAGES ? stages : MAX_STAGES), mhz(cpuMhz) {}
+
+    // Para convertir ciclos a µs; calibrate() no depende de ella
+    void setCpuMhz(uint16_t cpuMhz) { mhz = cpuMhz; }
+    void calibrate();
+
+    void record(uint8_t stage, uint32_t cycles) {
+      stageHistograms[stage].record(cycles > biasCycles ? cycles - biasCycles : 0);
+    }
+
+    // Intervalo entre dos lecturas del sensor, en ciclos, frente al nominal en µs
+    void recordInterval(uint32_t cycles, uint32_t expectedUs) {
+      jitterMeter.record(cycles / mhz, expectedUs);
+    }
+
+    void reset();
+
+    size_t stages() const { return stageCount; }
+    const char *stageName(size_t stage) const { return names[stage]; }
+    const LatencyHistogram &stage(size_t stage) const { return stageHistograms[stage]; }
+    const JitterMeter &jitter() const { return jitterMeter; }
+    uint16_t cpuMhz() const { return mhz; }
+    uint32_t readBiasCycles() const { return biasCycles; }
+    uint32_t recordCycles() const { return recordCost; }
+    uint32_t toUs(uint32_t cycles) const { return cycles / mhz; }
+
+    // Añade la sección DIAG_TAG_TIMING: MHz, ciclos de sobrecarga por medida y, por
+    // etapa, p50, p99 y máximo en µs (uint16, saturados); al final el jitter en µs
+    // (media cuadrática y mayor desviación absoluta)
+    void writeDiagnostics(TlvWriter &out) const;
+
+    // Histograma completo para la característica de tiempos (formato en TimingPacket.h):
+    // 'selected' es una etapa o stages() para el jitter
+    size_t packHistogram(uint8_t *out, size_t capacity, uint8_t selected) const;
+
+  private:
+    const char *const *names;
+    size_t stageCount;
+    uint16_t mhz;
+    uint32_t biasCycles = 0;
+    uint32_t recordCost = 0;
+    LatencyHistogram stageHistograms[MAX_STAGES];
+    JitterMeter jitterMeter;
+};
+
+// Mide el bloque en el que se declara como una etapa del perfil
+class TimingScope {
+  public:
+    TimingScope(TimingProfile &timingProfile, uint8_t timedStage)
+        : profile(timingProfile), stage(timedStage), start(cycleCount()) {}
+    ~TimingScope() { profile.record(stage, cycleCount() - start); }
+
+  private:
+    TimingProfile &profile;
+    uint8_t stage;
+    uint32_t start;
+};
@@ -0,0 +1,15 @@
+#include "NotifyScheduler.h"
+#include <ByteOrder.h>
+
+void NotifyScheduler::writeDiagnostics(TlvWriter &out) const {
+  uint8_t *p = out.section(DIAG_TAG_NOTIFY, 18);
+  if (p == NULL) return;
+  uint32_t ratio = sent > 0 ? (uint32_t)((uint64_t)received * 100 / sent) : 0;
+  p[0] = (uint8_t)queue.size();
+  p[1] = (uint8_t)queue.highWater();
+  putLe32(p + 2, queue.overflows());
+  putLe32(p + 6, received);
+  putLe32(p + 10, sent);
+  putLe16(p + 14, (uint16_t)(ratio > 0xFFFF ? 0xFFFF : ratio));
+  putLe16(p + 16, (uint16_t)(budgetMs > 0xFFFF ? 0xFFFF : budgetMs));
+}
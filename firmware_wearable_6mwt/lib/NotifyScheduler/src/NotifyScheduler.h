@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <SpscRing.h>
+#include <StepEventPacket.h>
+#include <CadencePacket.h>
+#include <LapPacket.h>
+#include <TlvWriter.h>
+
+// Actualizaciones que la detección deja para la tarea de notificaciones
+enum NotifyKind : uint8_t {
+  NOTIFY_STEP = 0,     // Evento de paso: se agrupa y su total acumulado sustituye al anterior
+  NOTIFY_CADENCE = 1,  // Paquete de cadencia: solo cuenta el más reciente
+  NOTIFY_LAP = 2       // Giro de 180°: se envía en cuanto se saca de la cola
+};
+
+struct NotifyUpdate {
+  uint8_t kind;
+  uint32_t queuedMs;
+  union {
+    StepEvent step;
+    uint8_t cadence[CADENCE_PACKET_SIZE];
+    uint8_t lap[LAP_PACKET_SIZE];
+  };
+};
+
+// Planificador de las notificaciones en vivo.
+//
+// La detección solo mete actualizaciones en una cola sin bloqueos (post()); una tarea
+// propia las saca con service() y decide cuándo notificar, de modo que la latencia del
+// stack BLE nunca cae en la ruta de muestreo y una racha de pasos no se convierte en
+// una racha de paquetes por radio. Mientras haya algo pendiente se combina: del total
+// de pasos y de la cadencia solo queda el último valor, y los eventos de paso se van
+// agrupando en el paquete de eventos. Todo lo pendiente sale junto cuando la
+// actualización más antigua cumple el presupuesto de latencia (o antes, si el paquete
+// de eventos se llena).
+//
+// Los envíos los hace quien llama con un Sink que tenga:
+//   size_t addStep(const StepEvent &)         agrupa un evento (si el paquete se llena,
+//                                             antes lo envía)
+//   size_t sendSteps(uint32_t steps)          envía lo agrupado y el total acumulado
+//   size_t sendCadence(const uint8_t *value)
+//   size_t sendLap(const uint8_t *value)
+// Cada método devuelve cuántas notificaciones llegó a hacer (0 sin tablet suscrita).
+// Un único productor y un único consumidor; no depende de Arduino.
+class NotifyScheduler {
+  public:
+    static const size_t QUEUE_SIZE = 64;
+    static const uint32_t IDLE = UINT32_MAX;
+
+    explicit NotifyScheduler(uint32_t latencyBudgetMs) : budgetMs(latencyBudgetMs) {}
+
+    // Productor: false si la cola está llena (la actualización se pierde y se cuenta)
+    bool post(const NotifyUpdate &update) { return queue.push(update); }
+
+    // Consumidor: saca lo pendiente, lo combina y envía lo vencido. Devuelve los ms
+    // hasta el siguiente vencimiento, o IDLE si no queda nada pendiente.
+    template <typename Sink>
+    uint32_t service(uint32_t now, Sink &sink) {
+      NotifyUpdate update;
+      while (queue.pop(update)) {
+        received++;
+        switch (update.kind) {
+          case NOTIFY_STEP:
+            sent += sink.addStep(update.step);
+            pendingSteps = update.step.steps;
+            hold(update.queuedMs, PENDING_STEPS);
+            break;
+          case NOTIFY_CADENCE:
+            for (size_t i = 0; i < CADENCE_PACKET_SIZE; i++) pendingCadence[i] = update.cadence[i];
+            hold(update.queuedMs, PENDING_CADENCE);
+            break;
+          case NOTIFY_LAP:
+            sent += sink.sendLap(update.lap);
+            break;
+        }
+      }
+
+      if (pending == 0) return IDLE;
+      uint32_t age = now - oldestMs;
+      if (age < budgetMs) return budgetMs - age;
+      if (pending & PENDING_STEPS) sent += sink.sendSteps(pendingSteps);
+      if (pending & PENDING_CADENCE) sent += sink.sendCadence(pendingCadence);
+      pending = 0;
+      return IDLE;
+    }
+
+    void setLatencyBudget(uint32_t ms) { budgetMs = ms; }
+    uint32_t latencyBudget() const { return budgetMs; }
+
+    // Actualizaciones recibidas y notificaciones hechas desde el arranque
+    uint32_t updates() const { return received; }
+    uint32_t notifications() const { return sent; }
+
+    // Añade la sección DIAG_TAG_NOTIFY: profundidad actual y máxima de la cola,
+    // actualizaciones perdidas por cola llena, actualizaciones recibidas,
+    // notificaciones hechas, relación de combinación x100 y presupuesto de latencia
+    void writeDiagnostics(TlvWriter &out) const;
+
+  private:
+    static const uint8_t PENDING_STEPS = 0x01;
+    static const uint8_t PENDING_CADENCE = 0x02;
+
+    void hold(uint32_t queuedMs, uint8_t what) {
+      if (pending == 0) oldestMs = queuedMs;
+      pending |= what;
+    }
+
+    SpscRing<NotifyUpdate, QUEUE_SIZE> queue;
+    uint32_t budgetMs;
+
+    // Estado del consumidor
+    uint8_t pending = 0;
+    uint32_t oldestMs = 0;
+    uint32_t pendingSteps = 0;
+    uint8_t pendingCadence[CADENCE_PACKET_SIZE] = {0};
+    uint32_t received = 0;
+    uint32_t sent = 0;
+};
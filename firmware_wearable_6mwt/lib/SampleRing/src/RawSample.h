@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Muestra cruda del acelerómetro: marca de tiempo reconstruida y cuentas del ADC
+struct RawSample {
+  uint32_t t_ms;
+  int16_t x;
+  int16_t y;
+  int16_t z;
+};
+
+// Muestra cruda del giroscopio, con el mismo instante que la del acelerómetro de su
+// posición de la FIFO
+struct RawGyroSample {
+  int16_t x;
+  int16_t y;
+  int16_t z;
+};
+
+// Módulo al cuadrado en cuentas: 3 * 32768² cabe en un uint32_t
+inline uint32_t magnitudeSquared(const RawSample &s) {
+  return (uint32_t)(s.x * s.x) + (uint32_t)(s.y * s.y) + (uint32_t)(s.z * s.z);
+}
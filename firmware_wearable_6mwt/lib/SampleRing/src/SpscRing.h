@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Cola circular sin bloqueos para un único productor y un único consumidor.
+// La memoria es un array fijo dentro del propio objeto: declarada como global
+// queda reservada estáticamente y nunca se usa el heap.
+//
+// Los índices avanzan libremente (uint32_t) y se enmascaran al acceder, por lo que
+// la capacidad debe ser potencia de dos. Solo el productor escribe 'head' y solo el
+// consumidor escribe 'tail'; el orden acquire/release publica el contenido del hueco
+// antes que el índice. No depende de Arduino, así que se puede probar en el host.
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "La capacidad de SpscRing debe ser potencia de dos");
+
+  public:
+    SpscRing() = default;
+
+    // Empieza con los dos índices en startIndex en lugar de 0. Solo para pruebas: con
+    // un valor cerca de UINT32_MAX se recorre la vuelta de los contadores.
+    explicit SpscRing(uint32_t startIndex) : head(startIndex), tail(startIndex) {}
+
+    // Productor: devuelve false (y cuenta el desbordamiento) si la cola está llena
+    bool push(const T &item) {
+      uint32_t h = head.load(std::memory_order_relaxed);
+      uint32_t used = h - tail.load(std::memory_order_acquire);
+      if (used >= Capacity) {
+        overflowCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      buffer[h & MASK] = item;
+      head.store(h + 1, std::memory_order_release);
+      if (used + 1 > highWaterMark.load(std::memory_order_relaxed)) {
+        highWaterMark.store(used + 1, std::memory_order_relaxed);
+      }
+      return true;
+    }
+
+    // Consumidor: devuelve false si no hay nada pendiente
+    bool pop(T &item) {
+      uint32_t t = tail.load(std::memory_order_relaxed);
+      if (t == head.load(std::memory_order_acquire)) return false;
+      item = buffer[t & MASK];
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Aproximado si se consulta desde un tercer hilo; exacto desde productor o consumidor
+    size_t size() const {
+      return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Elementos descartados por cola llena desde el arranque
+    uint32_t overflows() const { return overflowCount.load(std::memory_order_relaxed); }
+    // Máxima ocupación observada por el productor
+    uint32_t highWater() const { return highWaterMark.load(std::memory_order_relaxed); }
+
+  private:
+    static const uint32_t MASK = Capacity - 1;
+    // Índices en líneas de caché distintas para que productor y consumidor no se pisen
+    static const size_t CACHE_LINE = 64;
+
+    T buffer[Capacity];
+    alignas(CACHE_LINE) std::atomic<uint32_t> head{0};
+    alignas(CACHE_LINE) std::atomic<uint32_t> tail{0};
+    alignas(CACHE_LINE) std::atomic<uint32_t> overflowCount{0};
+    std::atomic<uint32_t> highWaterMark{0};
+};
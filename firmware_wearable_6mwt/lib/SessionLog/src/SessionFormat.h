@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <RawSample.h>
+#include <StepEventPacket.h>
+#include <SensorConfigPacket.h>
+#include <ByteOrder.h>
+
+// Formato de las sesiones grabadas en flash.
+//
+// Un fichero por sesión, hecho de páginas de SESSION_PAGE_SIZE bytes. Cada página lleva
+// registros completos uno tras otro (ninguno cruza de página) y el resto se rellena
+// con ceros: un byte de tipo SESSION_REC_PAD indica que la página no tiene más.
+// Todos los campos son little-endian.
+//
+//   HEADER   uint8 tipo, uint8 versión del formato, uint16 id de sesión,
+//            uint32 t_ms de inicio, uint8 ODR, uint8 rango, uint8 watermark
+//   SAMPLES  uint8 tipo, uint8 n, uint32 t_ms de la primera muestra, y n veces:
+//            uint8 ms desde la muestra anterior (saturado a 255), int16 x, y, z (cuentas)
+//   STEP     uint8 tipo, uint32 t_ms, uint32 pasos, uint16 pico (mg), uint16 intervalo (ms),
+//            uint16 longitud del paso (mm), uint32 distancia (mm): el StepEvent entero,
+//            con la longitud que la notificación no lleva
+//   SENSOR   uint8 tipo, uint8 ODR, uint8 rango, uint8 watermark: cambio en la sesión
+//   END      uint8 tipo, uint32 t_ms de fin, uint32 pasos, uint32 distancia (mm),
+//            uint32 registros perdidos por no poder escribir a tiempo
+//
+// Los códigos de ODR y rango son los de SensorConfigPacket.h; las cuentas de las
+// muestras están en el rango vigente en ese punto de la sesión.
+const uint8_t SESSION_FORMAT_VERSION = 1;
+const size_t SESSION_PAGE_SIZE = 4096;
+
+enum SessionRecordType : uint8_t {
+  SESSION_REC_PAD = 0x00,
+  SESSION_REC_HEADER = 0x01,
+  SESSION_REC_SAMPLES = 0x02,
+  SESSION_REC_STEP = 0x03,
+  SESSION_REC_SENSOR = 0x04,
+  SESSION_REC_END = 0x05
+};
+
+const size_t SESSION_HEADER_SIZE = 11;
+const size_t SESSION_SAMPLES_HEADER_SIZE = 6;
+const size_t SESSION_SAMPLE_SIZE = 7;
+const size_t SESSION_MAX_SAMPLES_PER_RECORD = 255;
+const size_t SESSION_STEP_SIZE = 19;
+const size_t SESSION_SENSOR_SIZE = 4;
+const size_t SESSION_END_SIZE = 17;
+
+inline size_t sessionSamplesSize(size_t n) {
+  return SESSION_SAMPLES_HEADER_SIZE + n * SESSION_SAMPLE_SIZE;
+}
+
+// Peor caso, en bytes de fichero, de una sesión de durationMs a sampleRateHz con
+// stepsPerMinute pasos. Cuenta las muestras, una cabecera SAMPLES cada
+// SESSION_MAX_SAMPLES_PER_RECORD muestras, tras cada paso (el registro STEP corta el
+// de muestras en curso) y al empezar cada página, los registros STEP, y el relleno de
+// cada página, que no llega a un registro STEP. Redondeado a páginas enteras.
+constexpr size_t sessionWorstCaseBytes(uint32_t sampleRateHz, uint32_t durationMs, uint32_t stepsPerMinute) {
+  size_t samples = (size_t)((uint64_t)sampleRateHz * durationMs / 1000) + 1;
+  size_t steps = (size_t)((uint64_t)stepsPerMinute * durationMs / 60000) + 1;
+  size_t records = samples / SESSION_MAX_SAMPLES_PER_RECORD + 1 + steps;
+  size_t data = SESSION_HEADER_SIZE + samples * SESSION_SAMPLE_SIZE + records * SESSION_SAMPLES_HEADER_SIZE +
+                steps * SESSION_STEP_SIZE + SESSION_END_SIZE;
+  size_t usable = SESSION_PAGE_SIZE - (SESSION_STEP_SIZE - 1) - SESSION_SAMPLES_HEADER_SIZE;
+  return (data + usable - 1) / usable * SESSION_PAGE_SIZE;
+}
+
+inline size_t packSessionHeader(uint8_t *out, uint16_t sessionId, uint32_t t_ms, const SensorConfig &sensor) {
+  out[0] = SESSION_REC_HEADER;
+  out[1] = SESSION_FORMAT_VERSION;
+  putLe16(out + 2, sessionId);
+  putLe32(out + 4, t_ms);
+  out[8] = sensor.odrCode;
+  out[9] = sensor.rangeCode;
+  out[10] = sensor.watermark;
+  return SESSION_HEADER_SIZE;
+}
+
+// Una muestra dentro de un registro SAMPLES; previousMs es el t_ms de la anterior
+inline size_t packSessionSample(uint8_t *out, const RawSample &sample, uint32_t previousMs) {
+  uint32_t delta = sample.t_ms - previousMs;
+  out[0] = delta > 255 ? 255 : (uint8_t)delta;
+  putLe16(out + 1, (uint16_t)sample.x);
+  putLe16(out + 3, (uint16_t)sample.y);
+  putLe16(out + 5, (uint16_t)sample.z);
+  return SESSION_SAMPLE_SIZE;
+}
+
+// n <= SESSION_MAX_SAMPLES_PER_RECORD
+inline size_t packSessionSamples(uint8_t *out, const RawSample *samples, size_t n) {
+  out[0] = SESSION_REC_SAMPLES;
+  out[1] = (uint8_t)n;
+  putLe32(out + 2, n > 0 ? samples[0].t_ms : 0);
+  uint8_t *p = out + SESSION_SAMPLES_HEADER_SIZE;
+  uint32_t previous = n > 0 ? samples[0].t_ms : 0;
+  for (size_t i = 0; i < n; i++) {
+    p += packSessionSample(p, samples[i], previous);
+    previous = samples[i].t_ms;
+  }
+  return sessionSamplesSize(n);
+}
+
+inline size_t packSessionStep(uint8_t *out, const StepEvent &event) {
+  out[0] = SESSION_REC_STEP;
+  putLe32(out + 1, event.t_ms);
+  putLe32(out + 5, event.steps);
+  putLe16(out + 9, event.peakMg);
+  putLe16(out + 11, event.intervalMs);
+  putLe16(out + 13, event.strideMm);
+  putLe32(out + 15, event.distanceMm);
+  return SESSION_STEP_SIZE;
+}
+
+inline size_t packSessionSensor(uint8_t *out, const SensorConfig &sensor) {
+  out[0] = SESSION_REC_SENSOR;
+  out[1] = sensor.odrCode;
+  out[2] = sensor.rangeCode;
+  out[3] = sensor.watermark;
+  return SESSION_SENSOR_SIZE;
+}
+
+inline size_t packSessionEnd(uint8_t *out, uint32_t t_ms, uint32_t steps, uint32_t distanceMm,
+                             uint32_t droppedRecords) {
+  out[0] = SESSION_REC_END;
+  putLe32(out + 1, t_ms);
+  putLe32(out + 5, steps);
+  putLe32(out + 9, distanceMm);
+  putLe32(out + 13, droppedRecords);
+  return SESSION_END_SIZE;
+}
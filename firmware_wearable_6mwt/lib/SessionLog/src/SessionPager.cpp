@@ -0,0 +1,63 @@
+#include "SessionPager.h"
+#include <string.h>
+
+bool SessionPager::takeFreePage() {
+  if (busy[next].load(std::memory_order_acquire)) return false;
+  active = next;
+  next ^= 1;
+  used = 0;
+  return true;
+}
+
+uint8_t *SessionPager::reserve(size_t len) {
+  // Cualquier otro registro va detrás del de muestras, que ya no puede crecer
+  samplesOpen = false;
+  if (len > SESSION_PAGE_SIZE) return NULL;
+  if (active != NO_PAGE && used + len > SESSION_PAGE_SIZE) seal();
+  if (active == NO_PAGE && !takeFreePage()) {
+    dropped++;
+    return NULL;
+  }
+  return &pages[active][used];
+}
+
+void SessionPager::commit(size_t len) {
+  used += len;
+}
+
+void SessionPager::appendSamples(const RawSample *samples, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    uint8_t *record = samplesOpen ? &pages[active][samplesStart] : NULL;
+    if (record != NULL && record[1] < SESSION_MAX_SAMPLES_PER_RECORD &&
+        used + SESSION_SAMPLE_SIZE <= SESSION_PAGE_SIZE) {
+      used += packSessionSample(&pages[active][used], samples[i], previousSampleMs);
+      record[1]++;
+    } else {
+      uint8_t *p = reserve(sessionSamplesSize(1));
+      if (p == NULL) return;
+      samplesStart = used;
+      commit(packSessionSamples(p, &samples[i], 1));
+      samplesOpen = true;
+    }
+    previousSampleMs = samples[i].t_ms;
+  }
+}
+
+void SessionPager::seal() {
+  samplesOpen = false;
+  if (active == NO_PAGE || used == 0) return;
+  memset(&pages[active][used], SESSION_REC_PAD, SESSION_PAGE_SIZE - used);
+  busy[active].store(true, std::memory_order_release);
+  sealed = active;
+  active = NO_PAGE;
+}
+
+uint8_t SessionPager::takeSealed() {
+  uint8_t index = sealed;
+  sealed = NO_PAGE;
+  return index;
+}
+
+void SessionPager::release(uint8_t index) {
+  busy[index].store(false, std::memory_order_release);
+}
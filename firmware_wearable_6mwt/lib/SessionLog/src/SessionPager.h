@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "SessionFormat.h"
+
+// Doble página en RAM entre quien genera los registros de la sesión y quien los
+// escribe en flash.
+//
+// El productor llena la página activa; cuando un registro ya no cabe, la cierra
+// (rellena con ceros), la entrega para escribir y sigue en la otra. Si la otra aún se
+// está escribiendo, el registro se descarta y se cuenta: el productor nunca espera a
+// la flash. Siempre se escriben páginas enteras, así que en el fichero quedan
+// alineadas a SESSION_PAGE_SIZE.
+//
+// Las muestras no van en un registro por ráfaga: appendSamples() sigue llenando el
+// registro SAMPLES abierto mientras sea el último de la página activa y no llegue a
+// SESSION_MAX_SAMPLES_PER_RECORD, así que el tamaño de la sesión no depende del
+// watermark de la FIFO (sessionWorstCaseBytes() en SessionFormat.h).
+//
+// Un único productor y un único consumidor, como SpscRing. No depende de Arduino.
+class SessionPager {
+  public:
+    static const uint8_t NO_PAGE = 0xFF;
+
+    // Productor: hueco de len bytes en la página activa (NULL si no hay página libre).
+    // El registro queda dentro con commit().
+    uint8_t *reserve(size_t len);
+    void commit(size_t len);
+
+    // Productor: añade muestras al registro SAMPLES abierto o abre otro. Si no hay
+    // página libre se descarta el resto de la ráfaga, como un registro perdido. Con
+    // ráfagas de menos de una página se cierra como mucho una página por llamada.
+    void appendSamples(const RawSample *samples, size_t n);
+
+    // Productor: cierra la página activa aunque no esté llena (fin de sesión)
+    void seal();
+
+    // Productor: página cerrada desde la última consulta, para avisar al consumidor
+    // (NO_PAGE si no hay). Con dos páginas nunca hay más de una pendiente de aviso.
+    uint8_t takeSealed();
+
+    // Consumidor: contenido de una página entregada y su devolución tras escribirla
+    const uint8_t *page(uint8_t index) const { return pages[index]; }
+    void release(uint8_t index);
+
+    uint32_t droppedRecords() const { return dropped; }
+    void resetDropped() { dropped = 0; }
+
+  private:
+    bool takeFreePage();
+
+    uint8_t pages[2][SESSION_PAGE_SIZE];
+    std::atomic<bool> busy[2] = {{false}, {false}};
+    uint8_t active = NO_PAGE;
+    uint8_t next = 0;
+    size_t used = 0;
+    uint8_t sealed = NO_PAGE;
+    // Registro SAMPLES que aún admite muestras: posición en la página activa y t_ms
+    // de su última muestra
+    bool samplesOpen = false;
+    size_t samplesStart = 0;
+    uint32_t previousSampleMs = 0;
+    uint32_t dropped = 0;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cascada de biquads en coma fija para filtrar la señal antes de la detección.
+//
+// Los coeficientes se calculan con funciones constexpr a partir de la frecuencia de
+// corte y la de muestreo, así que con argumentos constantes quedan en la imagen ya
+// cuantizados. Cada sección es una forma directa I con estado entero y acumulador de
+// 64 bits; no hay float ni heap en process(). No depende de Arduino.
+
+// Formatos de coeficiente. Un biquad necesita |a1| < 2, así que además del signo se
+// reserva un bit entero: Q15 guarda 14 bits fraccionarios en int16 y Q31 guarda 30 en
+// int32. Q15 ocupa la mitad, pero con cortes muy bajos respecto al muestreo pierde
+// precisión en la ganancia en continua; Q31 es el formato por defecto.
+struct Q15Format {
+  typedef int16_t Coeff;
+  static const int FRAC_BITS = 14;
+};
+
+struct Q31Format {
+  typedef int32_t Coeff;
+  static const int FRAC_BITS = 30;
+};
+
+template <typename Format>
+struct BiquadCoeffs {
+  typename Format::Coeff b0, b1, b2, a1, a2;
+};
+
+template <typename Format, size_t Sections>
+struct BiquadDesign {
+  BiquadCoeffs<Format> section[Sections];
+};
+
+namespace biquad_detail {
+
+constexpr double BIQUAD_PI = 3.14159265358979323846;
+
+// Seno por serie de Taylor tras reducir a [-pi, pi]: <cmath> no es constexpr en C++17
+constexpr double sine(double x) {
+  while (x > BIQUAD_PI) x -= 2 * BIQUAD_PI;
+  while (x < -BIQUAD_PI) x += 2 * BIQUAD_PI;
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 14; n++) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr double cosine(double x) { return sine(x + BIQUAD_PI / 2); }
+
+constexpr double tangent(double x) { return sine(x) / cosine(x); }
+
+template <typename Format>
+constexpr typename Format::Coeff quantize(double c) {
+  return (typename Format::Coeff)(c * (double)(1LL << Format::FRAC_BITS) + (c >= 0 ? 0.5 : -0.5));
+}
+
+} // namespace biquad_detail
+
+// Paso bajo Butterworth de orden 2 * Sections, por transformación bilineal con
+// predistorsión. La sección k lleva Q = 1 / (2 cos((2k + 1) pi / (4 Sections))).
+template <typename Format, size_t Sections>
+constexpr BiquadDesign<Format, Sections> butterworthLowPass(double cutoffHz, double sampleRateHz) {
+  BiquadDesign<Format, Sections> design{};
+  double k = biquad_detail::tangent(biquad_detail::BIQUAD_PI * cutoffHz / sampleRateHz);
+  for (size_t i = 0; i < Sections; i++) {
+    double q = 1.0 / (2.0 * biquad_detail::cosine(biquad_detail::BIQUAD_PI * (2.0 * i + 1.0) / (4.0 * Sections)));
+    double norm = 1.0 / (1.0 + k / q + k * k);
+    double b0 = k * k * norm;
+    design.section[i].b0 = biquad_detail::quantize<Format>(b0);
+    design.section[i].b1 = biquad_detail::quantize<Format>(2.0 * b0);
+    design.section[i].b2 = biquad_detail::quantize<Format>(b0);
+    design.section[i].a1 = biquad_detail::quantize<Format>(2.0 * (k * k - 1.0) * norm);
+    design.section[i].a2 = biquad_detail::quantize<Format>((1.0 - k / q + k * k) * norm);
+  }
+  return design;
+}
+
+// Filtro sobre muestras int32. La entrada debe dejar margen para el acumulador:
+// con |x| < 2^30 las cinco multiplicaciones de cada sección caben en 64 bits.
+// La primera muestra tras reset() inicializa el estado en régimen permanente, de modo
+// que el arranque no produce un transitorio desde cero.
+template <typename Format, size_t Sections>
+class BiquadCascade {
+  static_assert(Sections >= 1, "BiquadCascade necesita al menos una sección");
+
+  public:
+    typedef BiquadDesign<Format, Sections> Design;
+
+    explicit BiquadCascade(const Design &design) : coeffs(design) {}
+
+    int32_t process(int32_t x) {
+      if (!primed) prime(x);
+      for (size_t i = 0; i < Sections; i++) {
+        x = step(coeffs.section[i], state[i], x);
+      }
+      return x;
+    }
+
+    // Filtra un bloque (in y out pueden ser el mismo buffer). Recorre el bloque
+    // sección a sección, con coeficientes y estado en registros durante todo el bloque;
+    // el resultado es idéntico a llamar a process() muestra a muestra.
+    void processBlock(const int32_t *in, int32_t *out, size_t n) {
+      if (n == 0) return;
+      if (!primed) prime(in[0]);
+      for (size_t i = 0; i < Sections; i++) {
+        const BiquadCoeffs<Format> c = coeffs.section[i];
+        State s = state[i];
+        const int32_t *src = i == 0 ? in : out;
+        for (size_t k = 0; k < n; k++) {
+          out[k] = step(c, s, src[k]);
+        }
+        state[i] = s;
+      }
+    }
+
+    // Olvida el estado; la siguiente muestra vuelve a inicializarlo
+    void reset() { primed = false; }
+
+    void setDesign(const Design &design) {
+      coeffs = design;
+      reset();
+    }
+
+    const Design &design() const { return coeffs; }
+
+  private:
+    static const int64_t ROUNDING = 1LL << (Format::FRAC_BITS - 1);
+
+    struct State {
+      int32_t x1, x2, y1, y2;
+    };
+
+    static int32_t step(const BiquadCoeffs<Format> &c, State &s, int32_t x) {
+      int64_t acc = (int64_t)c.b0 * x + (int64_t)c.b1 * s.x1 + (int64_t)c.b2 * s.x2
+                  - (int64_t)c.a1 * s.y1 - (int64_t)c.a2 * s.y2;
+      acc = (acc + ROUNDING) >> Format::FRAC_BITS;
+      int32_t y = acc > INT32_MAX ? INT32_MAX : acc < INT32_MIN ? INT32_MIN : (int32_t)acc;
+      s.x2 = s.x1;
+      s.x1 = x;
+      s.y2 = s.y1;
+      s.y1 = y;
+      return y;
+    }
+
+    // Régimen permanente ante una entrada constante: en un paso bajo la ganancia en
+    // continua es 1, así que entradas y salidas anteriores valen lo mismo que x
+    void prime(int32_t x) {
+      for (size_t i = 0; i < Sections; i++) {
+        state[i] = State{x, x, x, x};
+      }
+      primed = true;
+    }
+
+    Design coeffs;
+    State state[Sections] = {};
+    bool primed = false;
+};
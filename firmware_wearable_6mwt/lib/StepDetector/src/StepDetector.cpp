@@ -0,0 +1,136 @@
+#include "StepDetector.h"
+
+// Vuelve a cuentas² la salida del filtro. El sobreimpulso puede salirse del rango de
+// entrada con un cambio brusco, así que se satura en ambos extremos.
+static uint32_t unshiftFiltered(int32_t y) {
+  const int32_t maxY = (int32_t)(UINT32_MAX >> STEP_FILTER_INPUT_SHIFT);
+  return y <= 0 ? 0 : y >= maxY ? UINT32_MAX : (uint32_t)y << STEP_FILTER_INPUT_SHIFT;
+}
+
+bool StepDetector::push(uint32_t magnitudeSq, uint32_t t_ms) {
+  if (cfg.filterEnabled) {
+    magnitudeSq = unshiftFiltered(filter.process((int32_t)(magnitudeSq >> STEP_FILTER_INPUT_SHIFT)));
+  }
+  return detect(magnitudeSq, t_ms);
+}
+
+void StepDetector::filterBlock(uint32_t *signal, size_t n) {
+  if (!cfg.filterEnabled) return;
+
+  int32_t filtered[BLOCK_SIZE];
+  for (size_t i = 0; i < n; i++) {
+    filtered[i] = (int32_t)(signal[i] >> STEP_FILTER_INPUT_SHIFT);
+  }
+  filter.processBlock(filtered, filtered, n);
+  for (size_t i = 0; i < n; i++) {
+    signal[i] = unshiftFiltered(filtered[i]);
+  }
+}
+
+void StepDetector::adapt(uint32_t x) {
+  if (!adaptStarted) {
+    meanSq = x;
+    peakEnvSq = cfg.highThresholdSq;
+    troughEnvSq = cfg.lowThresholdSq;
+    adaptStarted = true;
+  }
+
+  // Ataque en unas pocas muestras, decaimiento hacia la media en 2^decayShift
+  const uint8_t ATTACK_SHIFT = 2;
+  meanSq += (int32_t)(((int64_t)x - meanSq) >> cfg.meanShift);
+  if (x > peakEnvSq) {
+    peakEnvSq += (x - peakEnvSq) >> ATTACK_SHIFT;
+  } else {
+    peakEnvSq -= (int32_t)(((int64_t)peakEnvSq - meanSq) >> cfg.decayShift);
+  }
+  if (x < troughEnvSq) {
+    troughEnvSq -= (troughEnvSq - x) >> ATTACK_SHIFT;
+  } else {
+    troughEnvSq += (int32_t)(((int64_t)meanSq - troughEnvSq) >> cfg.decayShift);
+  }
+
+  uint32_t swing = peakEnvSq > meanSq ? (peakEnvSq - meanSq) >> 1 : 0;
+  if (swing < cfg.minSwingSq) swing = cfg.minSwingSq;
+  highSq = meanSq > UINT32_MAX - swing ? UINT32_MAX : meanSq + swing;
+  uint32_t dip = troughEnvSq < meanSq ? (meanSq - troughEnvSq) >> 2 : 0;
+  lowSq = meanSq - dip;
+}
+
+bool StepDetector::acceptPeak(uint32_t t_ms) {
+  uint32_t sinceCandidate = t_ms - lastCandidateMs;
+  bool hadCandidate = candidateSeen;
+  lastCandidateMs = t_ms;
+  candidateSeen = true;
+  if (!cfg.cadenceGate || !cadenceEstimator.ready()) return true;
+
+  if (cadenceEstimator.confidence() >= CADENCE_PERIODIC_CONFIDENCE && cadenceEstimator.periodMs() > 0) {
+    // Ritmo establecido: un pico demasiado pronto es un rebote, no un paso
+    return stepCount == 0 || t_ms - lastStepMs >= cadenceEstimator.periodMs() * 6 / 10;
+  }
+  // Señal no periódica: solo cuenta si hay otro pico a distancia de paso
+  return hadCandidate && sinceCandidate <= (uint32_t)(CadenceEstimator::MAX_PERIOD_S * 1000);
+}
+
+bool StepDetector::detect(uint32_t magnitudeSq, uint32_t t_ms) {
+  cadenceEstimator.push(magnitudeSq);
+  if (cfg.adaptive) adapt(magnitudeSq);
+  if (magnitudeSq < troughSq) troughSq = magnitudeSq;
+
+  if (magnitudeSq > highSq && !highPeakDetected) {
+    if (t_ms - lastStepMs > cfg.debounceMs) {
+      highPeakDetected = true;
+      peakSq = 0;
+    }
+  }
+
+  if (highPeakDetected && magnitudeSq > peakSq) {
+    peakSq = magnitudeSq;
+  }
+
+  if (highPeakDetected && magnitudeSq < lowSq) {
+    highPeakDetected = false;
+    if (!acceptPeak(t_ms)) {
+      rejected++;
+      return false;
+    }
+    lastInterval = stepCount > 0 ? t_ms - lastStepMs : 0;
+    lastPeak = peakSq;
+    lastTrough = troughSq;
+    troughSq = UINT32_MAX;
+    stepCount++;
+    lastStepMs = t_ms;
+    return true;
+  }
+  return false;
+}
+
+void StepDetector::configure(const Config &config) {
+  cfg = config;
+  filter.setDesign(cfg.filter);
+  cadenceEstimator.setSampleRate(cfg.sampleRateHz);
+  highSq = cfg.highThresholdSq;
+  lowSq = cfg.lowThresholdSq;
+  adaptStarted = false;
+  highPeakDetected = false;
+  troughSq = UINT32_MAX;
+  candidateSeen = false;
+}
+
+void StepDetector::reset() {
+  stepCount = 0;
+  lastStepMs = 0;
+  peakSq = 0;
+  lastPeak = 0;
+  troughSq = UINT32_MAX;
+  lastTrough = 0;
+  lastInterval = 0;
+  highPeakDetected = false;
+  filter.reset();
+  highSq = cfg.highThresholdSq;
+  lowSq = cfg.lowThresholdSq;
+  adaptStarted = false;
+  cadenceEstimator.reset();
+  lastCandidateMs = 0;
+  candidateSeen = false;
+  rejected = 0;
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <stdint.h>
+#include <RawSample.h>
+#include <Biquad.h>
+#include <BlockKernels.h>
+#include <CadenceEstimator.h>
+
+// --- Umbrales por defecto de la detección de pasos ---
+constexpr float ACCEL_THRESHOLD_HIGH = 12.0;
+constexpr float ACCEL_THRESHOLD_LOW = 9.5;
+constexpr uint32_t DEBOUNCE_TIME_MS = 350;
+
+// --- Filtro del módulo² antes de los umbrales ---
+// Paso bajo Butterworth de orden 2 * STEP_FILTER_SECTIONS: quita el ruido del sensor y
+// el rebote del impacto del talón que producían pasos dobles. STEP_FILTER_ENABLED = 0
+// deja la detección sin filtrar; STEP_FILTER_Q15 = 1 usa coeficientes de 16 bits.
+#ifndef STEP_FILTER_ENABLED
+#define STEP_FILTER_ENABLED 1
+#endif
+#ifndef STEP_FILTER_SECTIONS
+#define STEP_FILTER_SECTIONS 1
+#endif
+#ifndef STEP_FILTER_CUTOFF_HZ
+#define STEP_FILTER_CUTOFF_HZ 5.0
+#endif
+#ifndef STEP_FILTER_Q15
+#define STEP_FILTER_Q15 0
+#endif
+
+// ODR nominal con el que se diseña el filtro si quien construye el detector no indica otro
+constexpr double ACCEL_SAMPLE_RATE_HZ = 119.0;
+
+#if STEP_FILTER_Q15
+typedef Q15Format StepFilterFormat;
+#else
+typedef Q31Format StepFilterFormat;
+#endif
+typedef BiquadCascade<StepFilterFormat, STEP_FILTER_SECTIONS> StepFilter;
+
+// --- Umbrales adaptativos ---
+// Con STEP_DETECTOR_ADAPTIVE = 1 los umbrales siguen a la media y a las envolventes de
+// pico y valle de la señal en vez de quedar fijos en ACCEL_THRESHOLD_HIGH/LOW, para
+// no perder pasos de pacientes que arrastran los pies ni contar de más a los rápidos.
+#ifndef STEP_DETECTOR_ADAPTIVE
+#define STEP_DETECTOR_ADAPTIVE 0
+#endif
+
+// Constantes de tiempo de la media (unas cuantas zancadas) y del decaimiento de las
+// envolventes hacia la media cuando la marcha se suaviza
+constexpr double ADAPTIVE_MEAN_SECONDS = 2.0;
+constexpr double ADAPTIVE_DECAY_SECONDS = 1.0;
+// Separación mínima del umbral alto sobre la media: con el paciente parado el ruido no
+// debe alcanzarlo aunque las envolventes se hayan cerrado
+constexpr float ADAPTIVE_MIN_SWING = 0.8;
+
+// --- Filtro de periodicidad ---
+// Con STEP_CADENCE_GATE = 1 cada pico se contrasta con la cadencia estimada por
+// autocorrelación (CadenceEstimator): con la marcha periódica se rechazan los picos que
+// llegan antes del 60 % del periodo, y con la señal no periódica los picos aislados
+// (sin otro pico en MAX_PERIOD_S). El precio es el primer paso de cada arranque desde
+// parado, que no tiene vecino anterior, así que viene desactivado: se activa en
+// ejecución con el bit DEVICE_CONFIG_CADENCE_GATE de la configuración del dispositivo.
+#ifndef STEP_CADENCE_GATE
+#define STEP_CADENCE_GATE 0
+#endif
+constexpr float CADENCE_PERIODIC_CONFIDENCE = 0.5F;
+
+// El módulo² llega a 3 * 32768² y no cabe en el margen del filtro (|x| < 2^30):
+// se filtra en cuartos de cuenta², sin pérdida apreciable frente a los umbrales
+const int STEP_FILTER_INPUT_SHIFT = 2;
+
+// Sensibilidad del LSM9DS1 en ±2g (0.061 mg/LSB), también expresada en m/s² por cuenta
+constexpr float ACCEL_MG_PER_COUNT_2G = 0.061F;
+constexpr float ACCEL_MS2_PER_COUNT_2G = ACCEL_MG_PER_COUNT_2G / 1000.0F * 9.80665F;
+
+// Pasa un umbral en m/s² a cuentas² del ADC, para comparar sin float ni sqrt
+constexpr uint32_t squaredCounts(float ms2, float ms2PerCount = ACCEL_MS2_PER_COUNT_2G) {
+  return (uint32_t)((ms2 / ms2PerCount) * (ms2 / ms2PerCount));
+}
+
+// Mayor k con 2^k muestras <= 'seconds': las medias exponenciales se actualizan con
+// un desplazamiento en lugar de una división
+constexpr uint8_t shiftForSeconds(double seconds, double sampleRateHz) {
+  uint8_t k = 1;
+  while (k < 20 && (double)(1UL << (k + 1)) <= seconds * sampleRateHz) k++;
+  return k;
+}
+
+// Detector de pasos por umbral con histéresis: un pico por encima del umbral alto
+// seguido de una bajada por debajo del umbral bajo cuenta un paso, siempre que haya
+// pasado el tiempo de rebote desde el anterior.
+//
+// Cada muestra (ya filtrada) alimenta también al estimador de cadencia, que se puede
+// consultar con cadence() y, si cadenceGate, decide si el pico cuenta como paso.
+//
+// En modo adaptativo los umbrales se recalculan en cada muestra, en O(1) y con enteros:
+//   media        media exponencial del módulo² (ADAPTIVE_MEAN_SECONDS)
+//   envolventes  pico y valle con ataque rápido y decaimiento hacia la media
+//   umbral alto  media + (pico - media) / 2, al menos media + minSwingSq
+//   umbral bajo  media - (media - valle) / 4
+// Al arrancar las envolventes parten de los umbrales fijos, así que los primeros pasos
+// se detectan igual que sin adaptación.
+//
+// No depende de Arduino ni de relojes: el instante de cada muestra lo pone quien llama.
+class StepDetector {
+  public:
+    struct Config {
+      uint32_t highThresholdSq;
+      uint32_t lowThresholdSq;
+      uint32_t debounceMs;
+      bool filterEnabled;
+      StepFilter::Design filter;
+      bool adaptive;
+      uint32_t minSwingSq;
+      uint8_t meanShift;   // Constante de tiempo de la media: 2^meanShift muestras
+      uint8_t decayShift;  // Decaimiento de las envolventes: 2^decayShift muestras
+      bool cadenceGate;
+      double sampleRateHz;
+    };
+
+    // Los umbrales se guardan en cuentas², así que dependen de la escala del rango del
+    // acelerómetro; filtro y constantes de tiempo dependen del ritmo de muestreo
+    static constexpr Config defaultConfig(double sampleRateHz = ACCEL_SAMPLE_RATE_HZ,
+                                          float ms2PerCount = ACCEL_MS2_PER_COUNT_2G) {
+      return Config{squaredCounts(ACCEL_THRESHOLD_HIGH, ms2PerCount),
+                    squaredCounts(ACCEL_THRESHOLD_LOW, ms2PerCount),
+                    DEBOUNCE_TIME_MS, STEP_FILTER_ENABLED != 0,
+                    butterworthLowPass<StepFilterFormat, STEP_FILTER_SECTIONS>(
+                        STEP_FILTER_CUTOFF_HZ, sampleRateHz),
+                    STEP_DETECTOR_ADAPTIVE != 0,
+                    squaredCounts(9.80665F + ADAPTIVE_MIN_SWING, ms2PerCount) -
+                        squaredCounts(9.80665F, ms2PerCount),
+                    shiftForSeconds(ADAPTIVE_MEAN_SECONDS, sampleRateHz),
+                    shiftForSeconds(ADAPTIVE_DECAY_SECONDS, sampleRateHz),
+                    STEP_CADENCE_GATE != 0, sampleRateHz};
+    }
+
+    explicit StepDetector(const Config &config = defaultConfig())
+        : cfg(config), filter(config.filter), cadenceEstimator(config.sampleRateHz),
+          highSq(config.highThresholdSq), lowSq(config.lowThresholdSq) {}
+
+    // Procesa una muestra (módulo² en cuentas) y devuelve true si completa un paso.
+    // Con el filtro activo, umbrales y pico se aplican a la señal filtrada.
+    bool push(uint32_t magnitudeSq, uint32_t t_ms);
+
+    bool push(const RawSample &sample) { return push(magnitudeSquared(sample), sample.t_ms); }
+
+    // Procesa un bloque de muestras (p. ej. una ráfaga de la FIFO): módulo² y filtro
+    // se calculan para todo el bloque con los núcleos de BlockKernels y después se
+    // aplica la histéresis muestra a muestra. onStep(muestra) se llama en cada paso,
+    // con steps(), lastPeakSq() y lastIntervalMs() ya actualizados. El resultado es
+    // idéntico a llamar a push() con cada muestra, salvo con BLOCK_KERNELS_SIMD: el
+    // módulo² vectorial trunca cada eje (ver BlockKernels.h).
+    template <typename OnStep>
+    void pushBlock(const RawSample *samples, size_t n, OnStep onStep) {
+      uint32_t signal[BLOCK_SIZE];
+      while (n > 0) {
+        size_t chunk = n < BLOCK_SIZE ? n : BLOCK_SIZE;
+        blockMagnitudeSquared(samples, signal, chunk);
+        detectBlock(samples, signal, chunk, onStep);
+        samples += chunk;
+        n -= chunk;
+      }
+    }
+
+    // Igual, pero con la señal² ya calculada por quien llama (p. ej. la componente
+    // vertical al cuadrado de GravityEstimator); las muestras solo aportan el instante
+    template <typename OnStep>
+    void pushSquaredBlock(const RawSample *samples, const uint32_t *signalSq, size_t n, OnStep onStep) {
+      uint32_t signal[BLOCK_SIZE];
+      while (n > 0) {
+        size_t chunk = n < BLOCK_SIZE ? n : BLOCK_SIZE;
+        for (size_t i = 0; i < chunk; i++) signal[i] = signalSq[i];
+        detectBlock(samples, signal, chunk, onStep);
+        samples += chunk;
+        signalSq += chunk;
+        n -= chunk;
+      }
+    }
+
+    void reset();
+
+    // Cambia la configuración (p. ej. otro ODR o rango) sin perder el recuento: el
+    // estado de la señal (filtro, umbrales adaptativos, cadencia) vuelve a empezar
+    void configure(const Config &config);
+
+    uint32_t steps() const { return stepCount; }
+    uint32_t lastStepTime() const { return lastStepMs; }
+    // Rasgos del último paso: pico y valle de módulo² desde el paso anterior, y tiempo
+    // desde ese paso (0 si es el primero)
+    uint32_t lastPeakSq() const { return lastPeak; }
+    uint32_t lastTroughSq() const { return lastTrough; }
+    uint32_t lastIntervalMs() const { return lastInterval; }
+    const CadenceEstimator &cadence() const { return cadenceEstimator; }
+    // Picos que pasaron la histéresis pero no cuadraban con la cadencia
+    uint32_t rejectedPeaks() const { return rejected; }
+
+    // Umbrales vigentes (los fijos de la configuración si no es adaptativo)
+    uint32_t highThresholdSq() const { return highSq; }
+    uint32_t lowThresholdSq() const { return lowSq; }
+    const Config &config() const { return cfg; }
+
+    // Muestras por bloque interno de pushBlock() (los bloques mayores se trocean)
+    static const size_t BLOCK_SIZE = 32;
+
+  private:
+    bool detect(uint32_t magnitudeSq, uint32_t t_ms);
+    void filterBlock(uint32_t *signal, size_t n);
+
+    template <typename OnStep>
+    void detectBlock(const RawSample *samples, uint32_t *signal, size_t n, OnStep &onStep) {
+      filterBlock(signal, n);
+      for (size_t i = 0; i < n; i++) {
+        if (detect(signal[i], samples[i].t_ms)) onStep(samples[i]);
+      }
+    }
+
+    void adapt(uint32_t magnitudeSq);
+    bool acceptPeak(uint32_t t_ms);
+
+    Config cfg;
+    StepFilter filter;
+    CadenceEstimator cadenceEstimator;
+    uint32_t stepCount = 0;
+    uint32_t lastStepMs = 0;
+    uint32_t peakSq = 0;
+    uint32_t lastPeak = 0;
+    uint32_t troughSq = UINT32_MAX;
+    uint32_t lastTrough = 0;
+    uint32_t lastInterval = 0;
+    bool highPeakDetected = false;
+    uint32_t lastCandidateMs = 0;
+    bool candidateSeen = false;
+    uint32_t rejected = 0;
+
+    // Estado del modo adaptativo (en cuentas²)
+    uint32_t highSq;
+    uint32_t lowSq;
+    uint32_t meanSq = 0;
+    uint32_t peakEnvSq = 0;
+    uint32_t troughEnvSq = 0;
+    bool adaptStarted = false;
+};
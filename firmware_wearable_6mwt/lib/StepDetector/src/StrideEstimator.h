@@ -0,0 +1,50 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include "StepDetector.h"
+
+// Constante de Weinberg por defecto para el wearable en el cinturón, con el módulo ya
+// filtrado por StepDetector. Depende del paciente: se puede ajustar al compilar.
+#ifndef STRIDE_WEINBERG_K
+#define STRIDE_WEINBERG_K 0.45F
+#endif
+
+// Longitud de cada paso (lo que la app llama longitud de zancada) por el modelo de
+// Weinberg: L = K * (a_max - a_min)^(1/4), con los extremos del módulo de la
+// aceleración durante el paso en m/s². Se calcula una vez por paso (dos raíces y una
+// raíz cuarta), nunca por muestra, y acumula la distancia recorrida.
+class StrideEstimator {
+  public:
+    explicit StrideEstimator(float weinbergK = STRIDE_WEINBERG_K, float ms2PerCount = ACCEL_MS2_PER_COUNT_2G)
+        : k(weinbergK), scale(ms2PerCount) {}
+
+    // Registra un paso a partir de su pico y su valle de módulo² (cuentas²) y devuelve su
+    // longitud en mm
+    uint16_t onStep(uint32_t peakSq, uint32_t troughSq) {
+      float swing = (sqrtf((float)peakSq) - sqrtf((float)troughSq)) * scale;
+      float meters = swing > 0 ? k * sqrtf(sqrtf(swing)) : 0.0F;
+      uint32_t mm = (uint32_t)(meters * 1000.0F + 0.5F);
+      if (mm > 0xFFFF) mm = 0xFFFF;
+      lastMm = (uint16_t)mm;
+      totalMm += lastMm;
+      return lastMm;
+    }
+
+    void reset() {
+      lastMm = 0;
+      totalMm = 0;
+    }
+
+    void setScale(float ms2PerCount) { scale = ms2PerCount; }
+    void setK(float weinbergK) { k = weinbergK; }
+
+    uint16_t lastStrideMm() const { return lastMm; }
+    uint32_t distanceMm() const { return totalMm; }
+
+  private:
+    float k;
+    float scale;
+    uint16_t lastMm = 0;
+    uint32_t totalMm = 0;
+};
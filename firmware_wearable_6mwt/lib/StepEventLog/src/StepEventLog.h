@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <StepEventPacket.h>
+
+// Historial de los últimos eventos de paso, para reenviar los que la tablet no recibió.
+//
+// Los pasos se numeran de forma consecutiva (el total acumulado de cada evento), así
+// que el evento del paso k está siempre en (k - 1) % Capacity: insertar y buscar son
+// O(1) y, al llenarse, se sobrescriben los más antiguos.
+//
+// Un único escritor (la detección, append()) y un único lector (las notificaciones,
+// read()). El lector valida después de copiar: si mientras tanto el escritor pudo
+// reutilizar el hueco, read() devuelve false y el paso ya no está.
+template <size_t Capacity>
+class StepEventLog {
+  public:
+    void append(const StepEvent &event) {
+      events[(event.steps - 1) % Capacity] = event;
+      newestStep.store(event.steps, std::memory_order_release);
+    }
+
+    // Número del paso más reciente guardado (0 si no hay ninguno)
+    uint32_t newest() const { return newestStep.load(std::memory_order_acquire); }
+
+    // Número del paso más antiguo que se puede leer. Excluye el hueco que el siguiente
+    // append() va a sobrescribir, para que una copia en curso no lo pise.
+    uint32_t oldest() const {
+      uint32_t n = newest();
+      return n >= Capacity ? n - Capacity + 2 : 1;
+    }
+
+    bool contains(uint32_t step) const { return step >= oldest() && step <= newest(); }
+
+    // Copia el evento del paso 'step'; false si no está o se sobrescribió durante la copia
+    bool read(uint32_t step, StepEvent &out) const {
+      if (!contains(step)) return false;
+      out = events[(step - 1) % Capacity];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return step >= oldest();
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+  private:
+    StepEvent events[Capacity];
+    std::atomic<uint32_t> newestStep{0};
+};
@@ -0,0 +1,237 @@
+#include "StepReprocessor.h"
+#include <math.h>
+
+namespace {
+
+const float PI_F = 3.14159265F;
+
+// Biquad en float, forma directa I. Aquí no hace falta coma fija (StepFilter): se
+// ejecuta una vez por prueba y fuera de la ruta de tiempo real.
+struct FloatBiquad {
+  float b0, b1, b2, a1, a2;
+  float x1, x2, y1, y2;
+
+  float process(float x) {
+    float y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+    x2 = x1;
+    x1 = x;
+    y2 = y1;
+    y1 = y;
+    return y;
+  }
+
+  // Régimen permanente ante una entrada constante x, para que el borde de la ventana
+  // no produzca un transitorio: el paso bajo deja pasar la continua y el paso alto no
+  void prime(float x, bool highPass) {
+    float y = highPass ? 0.0F : x;
+    x1 = x2 = x;
+    y1 = y2 = y;
+  }
+};
+
+// Butterworth de orden 2 por transformación bilineal con predistorsión (Q = 1/sqrt(2))
+FloatBiquad butterworth(float cutoffHz, float sampleRateHz, bool highPass) {
+  float k = tanf(PI_F * cutoffHz / sampleRateHz);
+  float q = 0.70710678F;
+  float norm = 1.0F / (1.0F + k / q + k * k);
+  FloatBiquad f = {};
+  if (highPass) {
+    f.b0 = norm;
+    f.b1 = -2.0F * norm;
+  } else {
+    f.b0 = k * k * norm;
+    f.b1 = 2.0F * f.b0;
+  }
+  f.b2 = f.b0;
+  f.a1 = 2.0F * (k * k - 1.0F) * norm;
+  f.a2 = (1.0F - k / q + k * k) * norm;
+  return f;
+}
+
+// Paso banda hacia delante y después hacia atrás sobre el mismo buffer: el desfase de
+// la primera pasada lo deshace la segunda y la respuesta queda al cuadrado
+void filtfilt(float *signal, size_t n, const FloatBiquad &highPass, const FloatBiquad &lowPass) {
+  FloatBiquad hp = highPass;
+  FloatBiquad lp = lowPass;
+  hp.prime(signal[0], true);
+  lp.prime(0.0F, false);
+  for (size_t i = 0; i < n; i++) signal[i] = lp.process(hp.process(signal[i]));
+
+  hp = highPass;
+  lp = lowPass;
+  hp.prime(signal[n - 1], true);
+  lp.prime(0.0F, false);
+  for (size_t i = n; i-- > 0;) signal[i] = lp.process(hp.process(signal[i]));
+}
+
+} // namespace
+
+size_t StepReprocessor::workspaceBytes(size_t samples) {
+  // Como mucho un máximo local cada dos muestras
+  return samples * sizeof(float) + (samples / 2 + 2) * sizeof(Candidate);
+}
+
+StepReprocessor::Result StepReprocessor::run(const HistoryBuffer &history, uint32_t from, uint32_t to,
+                                             void *workspace, size_t workspaceSize) {
+  Result result = {};
+  result.status = NO_DATA;
+  if (from < history.begin()) {
+    result.status = OVERWRITTEN;
+    return result;
+  }
+  if (to > history.end()) to = history.end();
+  if (to <= from + 2) return result;
+
+  size_t n = to - from;
+  if (workspace == NULL || workspaceSize < workspaceBytes(n)) {
+    result.status = NO_MEMORY;
+    return result;
+  }
+  float *signal = (float*)workspace;
+  Candidate *candidates = (Candidate*)(signal + n);
+
+  // Copia por bloques a SRAM y de ahí a float; es la única lectura del historial, así
+  // que lo que siga escribiendo la detección mientras tanto no afecta
+  HistoryEntry block[HistoryBuffer::BLOCK];
+  size_t done = 0;
+  while (done < n) {
+    size_t want = n - done < HistoryBuffer::BLOCK ? n - done : HistoryBuffer::BLOCK;
+    size_t got = history.read(from + (uint32_t)done, block, want);
+    if (got == 0) {
+      result.status = OVERWRITTEN;
+      return result;
+    }
+    if (done == 0) result.fromMs = block[0].t_ms;
+    for (size_t i = 0; i < got; i++) {
+      signal[done + i] = sqrtf((float)block[i].signalSq) * cfg.ms2PerCount;
+      if (block[i].flags & HISTORY_STEP) result.liveSteps++;
+    }
+    result.toMs = block[got - 1].t_ms;
+    done += got;
+  }
+  result.samples = (uint32_t)n;
+
+  // Ritmo real de la ventana, por los instantes de las muestras y no por el ODR nominal
+  if (result.toMs <= result.fromMs) return result;
+  float rateHz = (float)(n - 1) * 1000.0F / (float)(result.toMs - result.fromMs);
+
+  filtfilt(signal, n, butterworth(cfg.lowCutoffHz, rateHz, true),
+           butterworth(cfg.highCutoffHz, rateHz, false));
+
+  size_t count = findCandidates(signal, n, candidates);
+  float level = threshold(candidates, count);
+  int32_t last = selectSteps(candidates, count, level, rateHz);
+
+  // Recorrido hacia atrás de la secuencia elegida: cada paso aporta su longitud con
+  // el valle desde el paso anterior (o desde el candidato anterior si abre la marcha)
+  uint32_t maxGap = (uint32_t)(cfg.maxIntervalMs * rateHz / 1000.0F);
+  for (int32_t j = last; j >= 0; j = candidates[j].prev) {
+    int32_t prev = candidates[j].prev;
+    float trough = candidates[j].valley;
+    if (prev >= 0 && candidates[j].index - candidates[prev].index < maxGap) {
+      for (int32_t k = j - 1; k > prev; k--) {
+        if (candidates[k].valley < trough) trough = candidates[k].valley;
+      }
+    }
+    float swing = candidates[j].height - trough;
+    if (swing > 0) result.distanceMm += (uint32_t)(cfg.weinbergK * sqrtf(sqrtf(swing)) * 1000.0F + 0.5F);
+    result.steps++;
+  }
+  result.status = DONE;
+  return result;
+}
+
+// Máximos locales por encima del mínimo absoluto, con el valle desde el anterior
+size_t StepReprocessor::findCandidates(const float *signal, size_t n, Candidate *candidates) {
+  size_t count = 0;
+  float valley = signal[0];
+  for (size_t i = 1; i + 1 < n; i++) {
+    float x = signal[i];
+    if (x < valley) valley = x;
+    if (x > signal[i - 1] && x >= signal[i + 1] && x > cfg.minAmplitudeMs2) {
+      Candidate &c = candidates[count++];
+      c.index = (uint32_t)i;
+      c.height = x;
+      c.valley = valley;
+      c.best = 0;
+      c.prev = -1;
+      valley = x;
+    }
+  }
+  return count;
+}
+
+// Umbral de pico: fracción de la altura mediana de los candidatos, que en una prueba
+// de marcha son casi todos pasos. La mediana sale de un histograma de 0.1 m/s².
+float StepReprocessor::threshold(Candidate *candidates, size_t count) {
+  const size_t BINS = 128;
+  const float BIN_MS2 = 0.1F;
+  uint32_t histogram[BINS] = {0};
+  for (size_t i = 0; i < count; i++) {
+    size_t bin = (size_t)(candidates[i].height / BIN_MS2);
+    histogram[bin < BINS ? bin : BINS - 1]++;
+  }
+  uint32_t seen = 0;
+  float median = 0;
+  for (size_t bin = 0; bin < BINS; bin++) {
+    seen += histogram[bin];
+    if (seen * 2 >= count) {
+      median = (bin + 0.5F) * BIN_MS2;
+      break;
+    }
+  }
+  float level = cfg.relativeAmplitude * median;
+  return level > cfg.minAmplitudeMs2 ? level : cfg.minAmplitudeMs2;
+}
+
+// Secuencia de candidatos de peso máximo. Un paso puede seguir a otro si están entre
+// minIntervalMs y maxIntervalMs y la señal bajó de la media entre ambos; a más de
+// maxIntervalMs empieza otro tramo de marcha y puede seguir a cualquier secuencia.
+// Devuelve el último candidato de la mejor secuencia (-1 si no hay ninguna).
+int32_t StepReprocessor::selectSteps(Candidate *candidates, size_t count, float level, float rateHz) {
+  const float UNREACHABLE = -1.0F;
+  uint32_t minGap = (uint32_t)(cfg.minIntervalMs * rateHz / 1000.0F);
+  uint32_t maxGap = (uint32_t)(cfg.maxIntervalMs * rateHz / 1000.0F);
+
+  // Mejor secuencia que acaba lo bastante atrás como para no condicionar al actual
+  size_t settled = 0;
+  float settledBest = 0;
+  int32_t settledLast = -1;
+
+  float overallBest = 0;
+  int32_t overallLast = -1;
+
+  for (size_t j = 0; j < count; j++) {
+    Candidate &c = candidates[j];
+    while (settled < j && candidates[settled].index + maxGap <= c.index) {
+      if (candidates[settled].best > settledBest) {
+        settledBest = candidates[settled].best;
+        settledLast = (int32_t)settled;
+      }
+      settled++;
+    }
+    if (c.height <= level) {
+      c.best = UNREACHABLE;
+      continue;
+    }
+
+    float bestPrev = settledBest;
+    int32_t prev = settledLast;
+    float valley = c.valley;
+    for (size_t k = j; k > settled; k--) {
+      const Candidate &p = candidates[k - 1];
+      if (p.best > bestPrev && valley < 0 && c.index - p.index >= minGap) {
+        bestPrev = p.best;
+        prev = (int32_t)(k - 1);
+      }
+      if (p.valley < valley) valley = p.valley;
+    }
+    c.best = bestPrev + (c.height - level);
+    c.prev = prev;
+    if (c.best > overallBest) {
+      overallBest = c.best;
+      overallLast = (int32_t)j;
+    }
+  }
+  return overallLast;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <HistoryBuffer.h>
+
+// Reprocesado de una prueba ya terminada sobre el historial (HistoryBuffer).
+//
+// El detector en vivo decide cada paso en el momento, con filtros causales y umbrales
+// que solo conocen el pasado. Aquí la prueba entera ya está en memoria, así que se
+// puede usar lo que no es causal:
+//   1. la señal del detector pasa a m/s² y se filtra hacia delante y hacia atrás con
+//      un paso banda Butterworth (fase cero: los picos no se desplazan ni se deforman);
+//   2. los máximos locales son candidatos, con peso = altura - umbral, y el umbral
+//      sale de la amplitud típica de los candidatos de toda la prueba;
+//   3. la secuencia de pasos se elige por programación dinámica para maximizar la suma
+//      de pesos, con separación mínima entre pasos y bajada por debajo de la media
+//      entre dos pasos seguidos: los picos dobles del talón se resuelven mirando toda
+//      la secuencia, no el primero que llega.
+// La distancia se recalcula con el modelo de Weinberg sobre los extremos de la señal
+// filtrada en cada paso.
+//
+// Coste O(n) en tiempo y ~14 bytes por muestra de memoria de trabajo, que pone quien
+// llama (en el firmware, PSRAM): seis minutos a 238 Hz son ~1.2 MB y unas decenas de
+// ms en el ESP32-S3. No depende de Arduino.
+class StepReprocessor {
+  public:
+    struct Config {
+      float ms2PerCount;       // Escala del rango con el que se grabó el historial
+      float weinbergK;
+      float lowCutoffHz;       // Paso alto: quita la gravedad y la deriva
+      float highCutoffHz;      // Paso bajo: quita el ruido y el impacto del talón
+      uint32_t minIntervalMs;  // Pasos más seguidos que esto no son posibles
+      uint32_t maxIntervalMs;  // Más separados, la marcha se considera interrumpida
+      float minAmplitudeMs2;   // Umbral mínimo de pico, con el paciente parado
+      float relativeAmplitude; // Umbral como fracción de la altura mediana de los picos
+    };
+
+    static constexpr Config defaultConfig(float ms2PerCount, float weinbergK) {
+      return Config{ms2PerCount, weinbergK, 0.5F, 3.0F, 250, 2000, 0.6F, 0.35F};
+    }
+
+    enum Status : uint8_t {
+      DONE = 0,
+      NO_DATA = 1,      // Historial vacío o sin muestras en la ventana
+      OVERWRITTEN = 2,  // El historial ya no tenía el principio de la ventana
+      NO_MEMORY = 3     // Memoria de trabajo insuficiente
+    };
+
+    struct Result {
+      Status status;
+      uint32_t fromMs;      // Instantes de la primera y la última muestra procesadas
+      uint32_t toMs;
+      uint32_t samples;
+      uint32_t liveSteps;   // Pasos que contó el detector en vivo en la ventana
+      uint32_t steps;       // Pasos tras el reprocesado
+      uint32_t distanceMm;
+    };
+
+    explicit StepReprocessor(const Config &config) : cfg(config) {}
+
+    // Memoria de trabajo necesaria para n muestras
+    static size_t workspaceBytes(size_t samples);
+
+    // Reprocesa las entradas [from, to) del historial (índices absolutos)
+    Result run(const HistoryBuffer &history, uint32_t from, uint32_t to,
+               void *workspace, size_t workspaceSize);
+
+  private:
+    struct Candidate {
+      uint32_t index;
+      float height;
+      float valley;  // Mínimo de la señal desde el candidato anterior
+      float best;    // Mejor suma de pesos de una secuencia que acaba aquí
+      int32_t prev;  // Candidato anterior en esa secuencia (-1 si empieza aquí)
+    };
+
+    size_t findCandidates(const float *signal, size_t n, Candidate *candidates);
+    float threshold(Candidate *candidates, size_t count);
+    int32_t selectSteps(Candidate *candidates, size_t count, float level, float rateHz);
+
+    Config cfg;
+};
@@ -0,0 +1,72 @@
+#include "TurnDetector.h"
+
+#include <math.h>
+#include <string.h>
+
+TurnDetector::TurnDetector(double sampleRateHz) {
+  setSampleRate(sampleRateHz);
+}
+
+void TurnDetector::setSampleRate(double sampleRateHz) {
+  dt = (float)(1.0 / sampleRateHz);
+  gravityAlpha = dt / GRAVITY_SECONDS;
+  double perBucket = sampleRateHz * WINDOW_S / BUCKETS;
+  samplesPerBucket = (uint16_t)(perBucket < 1 ? 1 : perBucket + 0.5);
+  reset();
+}
+
+void TurnDetector::reset() {
+  gravityStarted = false;
+  memset(buckets, 0, sizeof(buckets));
+  current = 0;
+  inBucket = 0;
+  windowSum = 0;
+  yawDps = 0;
+  turnCount = 0;
+  lastTurnMs = 0;
+  lastTurnDeg = 0;
+}
+
+bool TurnDetector::push(const RawSample &accel, const RawGyroSample &gyro) {
+  // La escala del acelerómetro se cancela al normalizar: basta con las cuentas
+  if (!gravityStarted) {
+    gx = accel.x;
+    gy = accel.y;
+    gz = accel.z;
+    gravityStarted = true;
+  } else {
+    gx += (accel.x - gx) * gravityAlpha;
+    gy += (accel.y - gy) * gravityAlpha;
+    gz += (accel.z - gz) * gravityAlpha;
+  }
+  float norm = sqrtf(gx * gx + gy * gy + gz * gz);
+  if (norm <= 0) return false;
+
+  // El acelerómetro en reposo marca +1 g hacia arriba, así que la proyección sobre él
+  // es la guiñada con el eje vertical hacia arriba
+  float w = (gyro.x * gx + gyro.y * gy + gyro.z * gz) / norm;
+  yawDps = w * GYRO_DPS_PER_COUNT_500;
+
+  float deg = yawDps * dt;
+  buckets[current] += deg;
+  windowSum += deg;
+
+  if (++inBucket >= samplesPerBucket) {
+    // El cubo más antiguo sale de la ventana y se reutiliza para el siguiente tramo.
+    // La suma se rehace entera: 32 sumas cada 1/8 s evitan que el error se acumule.
+    inBucket = 0;
+    current = (current + 1) % BUCKETS;
+    buckets[current] = 0;
+    windowSum = 0;
+    for (size_t i = 0; i < BUCKETS; i++) windowSum += buckets[i];
+  }
+
+  if (fabsf(windowSum) < TURN_DEGREES) return false;
+
+  lastTurnDeg = windowSum;
+  lastTurnMs = accel.t_ms;
+  turnCount++;
+  memset(buckets, 0, sizeof(buckets));
+  windowSum = 0;
+  return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <RawSample.h>
+
+// Sensibilidad del giroscopio del LSM9DS1 en ±500 dps (17.50 mdps/LSB)
+constexpr float GYRO_DPS_PER_COUNT_500 = 0.0175F;
+
+// Detector de giros de 180° en los extremos del pasillo de la 6MWT.
+//
+// El wearable puede ir en cualquier orientación, así que la guiñada se obtiene
+// proyectando la velocidad angular sobre la dirección de la gravedad, estimada con una
+// media lenta del acelerómetro. El ángulo girado se acumula en cubos de 1/8 s y se suma
+// sobre los últimos WINDOW_S segundos: un giro cuenta cuando esa suma supera
+// TURN_DEGREES en cualquier sentido. Sumar solo una ventana corta hace que el sesgo del
+// giroscopio (unos pocos °/s como mucho) no llegue nunca al umbral por sí solo.
+//
+// Tras un giro se vacía la ventana, de modo que el mismo giro no se cuenta dos veces.
+// O(1) por muestra y sin heap; no depende de Arduino.
+class TurnDetector {
+  public:
+    static constexpr float TURN_DEGREES = 150.0F;
+    static constexpr float WINDOW_S = 4.0F;
+    static const size_t BUCKETS = 32; // WINDOW_S / 32 = 1/8 s por cubo
+    // Constante de tiempo de la estimación de la gravedad
+    static constexpr float GRAVITY_SECONDS = 2.0F;
+
+    explicit TurnDetector(double sampleRateHz);
+
+    void setSampleRate(double sampleRateHz);
+
+    // Procesa una muestra; devuelve true si completa un giro
+    bool push(const RawSample &accel, const RawGyroSample &gyro);
+
+    void reset();
+
+    uint32_t turns() const { return turnCount; }
+    uint32_t lastTurnTime() const { return lastTurnMs; }
+    // Ángulo del último giro, con signo (positivo en sentido antihorario visto desde arriba)
+    float lastTurnDegrees() const { return lastTurnDeg; }
+    // Velocidad de guiñada de la última muestra, en °/s
+    float yawRate() const { return yawDps; }
+
+  private:
+    float dt = 0;
+    float gravityAlpha = 0;
+    uint16_t samplesPerBucket = 1;
+
+    float gx = 0, gy = 0, gz = 0;
+    bool gravityStarted = false;
+
+    float buckets[BUCKETS];
+    size_t current = 0;
+    uint16_t inBucket = 0;
+    float windowSum = 0;
+
+    float yawDps = 0;
+    uint32_t turnCount = 0;
+    uint32_t lastTurnMs = 0;
+    float lastTurnDeg = 0;
+};
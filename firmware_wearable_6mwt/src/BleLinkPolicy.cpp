@@ -0,0 +1,85 @@
+#include "BleLinkPolicy.h"
+
+struct LinkParams {
+  uint16_t minInterval;  // 1.25 ms
+  uint16_t maxInterval;  // 1.25 ms
+  uint16_t latency;      // eventos de conexión que el wearable puede saltarse
+  uint16_t timeout;      // 10 ms
+};
+
+// Prueba en curso: 7.5-15 ms sin latencia, cada paso sale en el siguiente evento
+static const LinkParams ACTIVE_PARAMS = {6, 12, 0, 400};
+// Reposo: 100-200 ms y hasta 4 eventos saltados si no hay nada que enviar
+static const LinkParams IDLE_PARAMS = {80, 160, 4, 600};
+
+void BleLinkPolicy::onConnect(const esp_bd_addr_t peer) {
+  memcpy(peerAddress, peer, sizeof(esp_bd_addr_t));
+  connected = true;
+  txPhy = 1;
+  rxPhy = 1;
+
+  // Se prefiere 2M en ambos sentidos; si la tablet no lo admite, el controlador sigue en 1M
+  // all_phys_mask = 0: hay preferencia tanto en transmisión como en recepción
+  esp_ble_gap_set_prefered_phy(peerAddress, 0,
+                               ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                               ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+  requestParams(LINK_IDLE);
+}
+
+void BleLinkPolicy::onDisconnect() {
+  connected = false;
+  intervalUnits = 0;
+  slaveLatency = 0;
+  supervisionTimeout = 0;
+}
+
+void BleLinkPolicy::update(bool active) {
+  Mode wanted = active ? LINK_ACTIVE : LINK_IDLE;
+  if (!connected || wanted == currentMode) return;
+  requestParams(wanted);
+}
+
+void BleLinkPolicy::requestParams(Mode mode) {
+  const LinkParams &p = mode == LINK_ACTIVE ? ACTIVE_PARAMS : IDLE_PARAMS;
+
+  esp_ble_conn_update_params_t params;
+  memcpy(params.bda, peerAddress, sizeof(esp_bd_addr_t));
+  params.min_int = p.minInterval;
+  params.max_int = p.maxInterval;
+  params.latency = p.latency;
+  params.timeout = p.timeout;
+  esp_ble_gap_update_conn_params(&params);
+  currentMode = mode;
+}
+
+void BleLinkPolicy::handleGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+  switch (event) {
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+      if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+        intervalUnits = param->update_conn_params.conn_int;
+        slaveLatency = param->update_conn_params.latency;
+        supervisionTimeout = param->update_conn_params.timeout;
+      }
+      break;
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+      if (param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+        txPhy = param->phy_update.tx_phy;
+        rxPhy = param->phy_update.rx_phy;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void BleLinkPolicy::writeDiagnostics(TlvWriter &out, uint16_t mtu) const {
+  uint8_t *p = out.section(DIAG_TAG_LINK, 11);
+  if (p == NULL) return;
+  putLe16(p, intervalUnits);
+  putLe16(p + 2, slaveLatency);
+  putLe16(p + 4, supervisionTimeout);
+  p[6] = txPhy;
+  p[7] = rxPhy;
+  p[8] = currentMode;
+  putLe16(p + 9, mtu);
+}
@@ -0,0 +1,57 @@
+#include "ConfigStore.h"
+#include <Preferences.h>
+#include <StepDetector.h>
+#include <StrideEstimator.h>
+
+static const char *NVS_NAMESPACE = "wearable";
+static const char *NVS_CONFIG_KEY = "config";
+
+// UUIDs con los que se publicó la app: servicio 4fafc201-1fb5-459e-8fcc-c5c9c331914b y
+// características beb5483e-36e1-4688-b7f5-ea07361b26xx
+static const uint8_t DEFAULT_SERVICE_UUID[UUID_SIZE] = {
+  0x4f, 0xaf, 0xc2, 0x01, 0x1f, 0xb5, 0x45, 0x9e, 0x8f, 0xcc, 0xc5, 0xc9, 0xc3, 0x31, 0x91, 0x4b
+};
+static const uint8_t DEFAULT_CHARACTERISTIC_UUID_BASE[UUID_SIZE] = {
+  0xbe, 0xb5, 0x48, 0x3e, 0x36, 0xe1, 0x46, 0x88, 0xb7, 0xf5, 0xea, 0x07, 0x36, 0x1b, 0x26, 0x00
+};
+
+DeviceConfig ConfigStore::defaults() {
+  DeviceConfig config;
+  memset(&config, 0, sizeof(config));
+  config.version = DEVICE_CONFIG_VERSION;
+  config.thresholdHighCms2 = (uint16_t)(ACCEL_THRESHOLD_HIGH * 100 + 0.5F);
+  config.thresholdLowCms2 = (uint16_t)(ACCEL_THRESHOLD_LOW * 100 + 0.5F);
+  config.debounceMs = DEBOUNCE_TIME_MS;
+  config.strideKx1000 = (uint16_t)(STRIDE_WEINBERG_K * 1000 + 0.5F);
+  config.flags = (STEP_DETECTOR_ADAPTIVE ? DEVICE_CONFIG_ADAPTIVE : 0) |
+                 (STEP_CADENCE_GATE ? DEVICE_CONFIG_CADENCE_GATE : 0) |
+                 (STEP_FILTER_ENABLED ? DEVICE_CONFIG_FILTER : 0);
+  // 119 Hz, ±2g y watermark de 20: ~170 ms por ráfaga y 120 bytes, una sola transacción I2C
+  config.sensor = SensorConfig{1, 0, 20};
+  strncpy(config.deviceName, "WearableDistancia6MWT", DEVICE_NAME_MAX);
+  memcpy(config.serviceUuid, DEFAULT_SERVICE_UUID, UUID_SIZE);
+  memcpy(config.characteristicUuidBase, DEFAULT_CHARACTERISTIC_UUID_BASE, UUID_SIZE);
+  return config;
+}
+
+bool ConfigStore::load(DeviceConfig &out) {
+  out = defaults();
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) return false; // Primer arranque: el espacio aún no existe
+
+  DeviceConfig stored;
+  // Un blob de otro tamaño (otra versión de la estructura) no se lee: getBytes devuelve 0
+  size_t length = prefs.getBytes(NVS_CONFIG_KEY, &stored, sizeof(stored));
+  prefs.end();
+  if (length != sizeof(stored) || !validDeviceConfig(stored)) return false;
+  out = stored;
+  return true;
+}
+
+bool ConfigStore::save(const DeviceConfig &config) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) return false;
+  size_t written = prefs.putBytes(NVS_CONFIG_KEY, &config, sizeof(config));
+  prefs.end();
+  return written == sizeof(config);
+}
@@ -0,0 +1,162 @@
+#include "Lsm9ds1Fifo.h"
+
+#include <esp_timer.h>
+
+// Dirección I2C y registros del bloque acelerómetro/giroscopio (datasheet LSM9DS1)
+static const uint8_t XG_ADDRESS = 0x6B;
+static const uint8_t REG_INT1_CTRL = 0x0C;
+static const uint8_t REG_CTRL_REG1_G = 0x10;
+static const uint8_t REG_OUT_X_L_G = 0x18;
+static const uint8_t REG_CTRL_REG6_XL = 0x20;
+static const uint8_t REG_CTRL_REG8 = 0x22;
+static const uint8_t REG_CTRL_REG9 = 0x23;
+static const uint8_t REG_OUT_X_L_XL = 0x28;
+static const uint8_t REG_FIFO_CTRL = 0x2E;
+static const uint8_t REG_FIFO_SRC = 0x2F;
+
+static const uint8_t INT1_CTRL_FTH = 0x08;
+static const uint8_t CTRL_REG8_IF_ADD_INC = 0x04;
+static const uint8_t CTRL_REG9_FIFO_EN = 0x02;
+static const uint8_t FIFO_MODE_CONTINUOUS = 0xC0;
+static const uint8_t FIFO_SRC_OVRN = 0x40;
+static const uint8_t FIFO_SRC_FSS_MASK = 0x3F;
+// Escala del giroscopio ±500 dps (FS_G = 01); ODR_G ocupa los mismos bits que ODR_XL
+static const uint8_t CTRL_REG1_G_FS_500DPS = 0x08;
+
+static const size_t BYTES_PER_SAMPLE = 6;
+// El buffer de Wire en el ESP32 es de 128 bytes: 21 muestras caben en una sola transacción
+static const size_t SAMPLES_PER_TRANSFER = 21;
+
+bool Lsm9ds1Fifo::begin(DataRate rate, uint8_t watermark, bool withGyro, TwoWire &wire) {
+  bus = &wire;
+  gyroOn = withGyro;
+
+  // Autoincremento de dirección para poder leer X, Y, Z en ráfaga
+  if (!writeRegister(REG_CTRL_REG8, CTRL_REG8_IF_ADD_INC)) return false;
+  return configure(rate, RANGE_2G, watermark);
+}
+
+bool Lsm9ds1Fifo::configure(DataRate rate, AccelRange range, uint8_t watermark) {
+  fifoWatermark = min<uint8_t>(watermark, FIFO_SLOTS - 1);
+  odr = rate;
+  fullScale = range;
+
+  switch (rate) {
+    case ODR_50HZ:  periodUs = gyroOn ? 16807 : 20000; break; // ODR_G 010 es 59.5 Hz
+    case ODR_119HZ: periodUs = 8403;  break;
+    case ODR_238HZ: periodUs = 4202;  break;
+  }
+
+  // Pasar por bypass vacía la FIFO antes de cambiar el ODR y de volver al modo continuo
+  if (!writeRegister(REG_FIFO_CTRL, 0x00)) return false;
+  // Sin giroscopio se apaga: activo, la FIFO guarda también sus datos en cada posición
+  if (!writeRegister(REG_CTRL_REG1_G, gyroOn ? (rate | CTRL_REG1_G_FS_500DPS) : 0x00)) return false;
+  // ODR y rango (FS_XL) del acelerómetro
+  if (!writeRegister(REG_CTRL_REG6_XL, rate | range)) return false;
+
+  if (fifoWatermark == 0) return writeRegister(REG_CTRL_REG9, 0x00);
+  if (!writeRegister(REG_CTRL_REG9, CTRL_REG9_FIFO_EN)) return false;
+  return writeRegister(REG_FIFO_CTRL, FIFO_MODE_CONTINUOUS | fifoWatermark);
+}
+
+float Lsm9ds1Fifo::mgPerCount(AccelRange range) {
+  switch (range) {
+    case RANGE_4G:  return 0.122F;
+    case RANGE_8G:  return 0.244F;
+    case RANGE_16G: return 0.732F;
+    default:        return 0.061F;
+  }
+}
+
+bool Lsm9ds1Fifo::enableWatermarkInterrupt() {
+  // INT1 es push-pull y activo a nivel alto (CTRL_REG8 por defecto): queda en alto
+  // mientras la FIFO tenga al menos 'watermark' muestras
+  return writeRegister(REG_INT1_CTRL, INT1_CTRL_FTH);
+}
+
+bool Lsm9ds1Fifo::readAccel(RawSample &out) {
+  uint8_t p[BYTES_PER_SAMPLE];
+  if (!readRegisters(REG_OUT_X_L_XL, p, BYTES_PER_SAMPLE)) return false;
+  out.t_ms = millis();
+  out.x = (int16_t)(p[0] | (p[1] << 8));
+  out.y = (int16_t)(p[2] | (p[3] << 8));
+  out.z = (int16_t)(p[4] | (p[5] << 8));
+  return true;
+}
+
+uint8_t Lsm9ds1Fifo::pending() {
+  uint8_t src = 0;
+  if (!readRegisters(REG_FIFO_SRC, &src, 1)) return 0;
+  if (src & FIFO_SRC_OVRN) overrunCount++;
+  return src & FIFO_SRC_FSS_MASK;
+}
+
+size_t Lsm9ds1Fifo::drain(RawSample *out, RawGyroSample *gyroOut, size_t maxSamples) {
+  size_t count = min<size_t>(pending(), maxSamples);
+  if (count == 0) return 0;
+
+  // millis() es esp_timer_get_time() / 1000 truncado: partir del mismo contador de 64 bits
+  // deja las marcas en la base de readAccel() sin la vuelta de micros() cada 71 minutos
+  int64_t nowUs = esp_timer_get_time();
+
+  if (gyroOn) {
+    // Cada posición se lee en dos ráfagas, giroscopio y después acelerómetro; se leen
+    // siempre las dos mitades para no desalinear la FIFO aunque no se quiera el giroscopio
+    uint8_t p[BYTES_PER_SAMPLE];
+    for (size_t i = 0; i < count; i++) {
+      if (!readRegisters(REG_OUT_X_L_G, p, BYTES_PER_SAMPLE)) return i;
+      if (gyroOut != NULL) {
+        gyroOut[i].x = (int16_t)(p[0] | (p[1] << 8));
+        gyroOut[i].y = (int16_t)(p[2] | (p[3] << 8));
+        gyroOut[i].z = (int16_t)(p[4] | (p[5] << 8));
+      }
+      if (!readRegisters(REG_OUT_X_L_XL, p, BYTES_PER_SAMPLE)) return i;
+      int64_t age = (int64_t)(count - 1 - i);
+      out[i].t_ms = (uint32_t)((nowUs - age * periodUs) / 1000);
+      out[i].x = (int16_t)(p[0] | (p[1] << 8));
+      out[i].y = (int16_t)(p[2] | (p[3] << 8));
+      out[i].z = (int16_t)(p[4] | (p[5] << 8));
+    }
+    return count;
+  }
+  uint8_t buffer[SAMPLES_PER_TRANSFER * BYTES_PER_SAMPLE];
+  size_t done = 0;
+
+  // Con la FIFO activa, la dirección vuelve a OUT_X_L_XL tras OUT_Z_H_XL,
+  // así que una sola lectura encadena varias muestras consecutivas.
+  while (done < count) {
+    size_t chunk = min(count - done, SAMPLES_PER_TRANSFER);
+    if (!readRegisters(REG_OUT_X_L_XL, buffer, chunk * BYTES_PER_SAMPLE)) break;
+
+    for (size_t i = 0; i < chunk; i++) {
+      const uint8_t *p = &buffer[i * BYTES_PER_SAMPLE];
+      RawSample &s = out[done + i];
+      // La última muestra leída es la más reciente: las anteriores se separan un periodo cada una
+      int64_t age = (int64_t)(count - 1 - (done + i));
+      s.t_ms = (uint32_t)((nowUs - age * periodUs) / 1000);
+      s.x = (int16_t)(p[0] | (p[1] << 8));
+      s.y = (int16_t)(p[2] | (p[3] << 8));
+      s.z = (int16_t)(p[4] | (p[5] << 8));
+    }
+    done += chunk;
+  }
+  return done;
+}
+
+bool Lsm9ds1Fifo::writeRegister(uint8_t reg, uint8_t value) {
+  bus->beginTransmission(XG_ADDRESS);
+  bus->write(reg);
+  bus->write(value);
+  return bus->endTransmission() == 0;
+}
+
+bool Lsm9ds1Fifo::readRegisters(uint8_t reg, uint8_t *buffer, size_t len) {
+  bus->beginTransmission(XG_ADDRESS);
+  bus->write(reg);
+  if (bus->endTransmission(false) != 0) return false;
+  if (bus->requestFrom(XG_ADDRESS, (uint8_t)len) != len) return false;
+  for (size_t i = 0; i < len; i++) {
+    buffer[i] = bus->read();
+  }
+  return true;
+}
@@ -0,0 +1,69 @@
+#include "SessionFileStore.h"
+#include <LittleFS.h>
+
+size_t SessionFileStore::refresh() {
+  count = 0;
+  File dir = LittleFS.open(SessionRecorder::sessionDir());
+  if (!dir) return 0;
+  for (File f = dir.openNextFile(); f && count < MAX_LISTED; f = dir.openNextFile()) {
+    uint32_t sequence;
+    if (!SessionRecorder::sessionSequenceFromName(f.name(), sequence)) continue;
+    FileInfo entry = {SessionRecorder::sessionIdOf(sequence), (uint32_t)f.size(), 0};
+    if (recorder.recording() && recorder.sessionId() == entry.id) entry.flags |= FT_FLAG_RECORDING;
+    // Inserción ordenada por secuencia (el id da la vuelta): son pocas sesiones y el
+    // directorio no garantiza orden
+    size_t i = count++;
+    while (i > 0 && sequences[i - 1] > sequence) {
+      entries[i] = entries[i - 1];
+      sequences[i] = sequences[i - 1];
+      i--;
+    }
+    entries[i] = entry;
+    sequences[i] = sequence;
+  }
+  return count;
+}
+
+bool SessionFileStore::info(size_t index, FileInfo &out) {
+  if (index >= count) return false;
+  out = entries[index];
+  return true;
+}
+
+bool SessionFileStore::open(uint16_t id, uint32_t &size) {
+  close();
+  uint32_t sequence;
+  if (!findSequence(id, sequence)) return false;
+  char path[SessionRecorder::PATH_SIZE];
+  SessionRecorder::sessionPath(sequence, path);
+  file = LittleFS.open(path, FILE_READ);
+  if (!file) return false;
+  size = (uint32_t)file.size();
+  return true;
+}
+
+size_t SessionFileStore::read(uint32_t offset, uint8_t *out, size_t len) {
+  if (!file) return 0;
+  if (file.position() != offset && !file.seek(offset)) return 0;
+  return file.read(out, len);
+}
+
+// El cliente puede leer sin haber listado (p. ej. al reanudar tras reconectar), así que
+// se busca en el directorio; si dos secuencias compartiesen id, la más reciente
+bool SessionFileStore::findSequence(uint16_t id, uint32_t &sequence) {
+  bool found = false;
+  File dir = LittleFS.open(SessionRecorder::sessionDir());
+  if (!dir) return false;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    uint32_t candidate;
+    if (!SessionRecorder::sessionSequenceFromName(f.name(), candidate)) continue;
+    if (SessionRecorder::sessionIdOf(candidate) != id || (found && candidate < sequence)) continue;
+    sequence = candidate;
+    found = true;
+  }
+  return found;
+}
+
+void SessionFileStore::close() {
+  if (file) file.close();
+}
@@ -0,0 +1,161 @@
+#include "SessionRecorder.h"
+#include <FS.h>
+#include <LittleFS.h>
+
+static const char *SESSION_DIR = "/sessions";
+// Apertura, cierre y las dos páginas, con margen para una sesión que empieza mientras
+// la anterior aún se cierra
+static const UBaseType_t COMMAND_QUEUE_LENGTH = 8;
+
+void SessionRecorder::sessionPath(uint32_t sequence, char *out) {
+  snprintf(out, PATH_SIZE, "%s/%05lu.bin", SESSION_DIR, (unsigned long)sequence);
+}
+
+const char *SessionRecorder::sessionDir() {
+  return SESSION_DIR;
+}
+
+// Los nombres de cinco cifras de antes de la secuencia de 32 bits se leen igual
+bool SessionRecorder::sessionSequenceFromName(const char *name, uint32_t &sequence) {
+  const char *base = strrchr(name, '/');
+  base = base ? base + 1 : name;
+  if (*base < '0' || *base > '9') return false;
+  char *end = NULL;
+  unsigned long value = strtoul(base, &end, 10);
+  if (strcmp(end, ".bin") != 0 || value > UINT32_MAX) return false;
+  sequence = (uint32_t)value;
+  return true;
+}
+
+bool SessionRecorder::begin(UBaseType_t writerPriority, BaseType_t writerCore) {
+  if (!LittleFS.begin(true)) return false;
+  if (!LittleFS.exists(SESSION_DIR)) LittleFS.mkdir(SESSION_DIR);
+
+  // Las sesiones se numeran a continuación de la última que quedó en flash
+  File dir = LittleFS.open(SESSION_DIR);
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    uint32_t sequence;
+    if (sessionSequenceFromName(f.name(), sequence) && sequence > lastSequence) lastSequence = sequence;
+  }
+
+  commands = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(Command));
+  if (commands == NULL) return false;
+  return xTaskCreatePinnedToCore(writerTask, "recorder", 4096, this,
+                                 writerPriority, NULL, writerCore) == pdPASS;
+}
+
+bool SessionRecorder::start(uint32_t t_ms, const SensorConfig &sensor) {
+  if (commands == NULL || active) return false;
+  currentSequence = ++lastSequence;
+  startMs = t_ms;
+  sampled = false;
+  pager.resetDropped();
+  post(CMD_OPEN);
+  active = true;
+
+  uint8_t *p = pager.reserve(SESSION_HEADER_SIZE);
+  if (p != NULL) pager.commit(packSessionHeader(p, sessionId(), t_ms, sensor));
+  postSealed();
+  return true;
+}
+
+void SessionRecorder::stop(uint32_t t_ms, uint32_t steps, uint32_t distanceMm) {
+  if (!active) return;
+  uint8_t *p = pager.reserve(SESSION_END_SIZE);
+  if (p != NULL) pager.commit(packSessionEnd(p, t_ms, steps, distanceMm, pager.droppedRecords()));
+  postSealed();
+  // La última página va incompleta, rellena con ceros como todas
+  pager.seal();
+  postSealed();
+  post(CMD_CLOSE);
+  active = false;
+}
+
+void SessionRecorder::appendSamples(const RawSample *samples, size_t n) {
+  if (!active || n == 0) return;
+  if (!sampled) firstSampleMs = samples[0].t_ms;
+  sampled = true;
+  lastSampleMs = samples[n - 1].t_ms;
+  pager.appendSamples(samples, n);
+  postSealed();
+}
+
+void SessionRecorder::appendStep(const StepEvent &event) {
+  if (!active) return;
+  uint8_t *p = pager.reserve(SESSION_STEP_SIZE);
+  if (p != NULL) pager.commit(packSessionStep(p, event));
+  postSealed();
+}
+
+void SessionRecorder::appendSensorConfig(const SensorConfig &sensor) {
+  if (!active) return;
+  uint8_t *p = pager.reserve(SESSION_SENSOR_SIZE);
+  if (p != NULL) pager.commit(packSessionSensor(p, sensor));
+  postSealed();
+}
+
+void SessionRecorder::postSealed() {
+  uint8_t page = pager.takeSealed();
+  if (page != SessionPager::NO_PAGE) post(CMD_PAGE, page);
+}
+
+// Sin espera: si la cola estuviese llena la página se devuelve sin escribir
+void SessionRecorder::post(CommandKind kind, uint8_t page) {
+  Command command = {kind, page, currentSequence};
+  if (xQueueSend(commands, &command, 0) != pdTRUE) {
+    errors++;
+    if (kind == CMD_PAGE) pager.release(page);
+  }
+}
+
+// Borra las sesiones más antiguas (menor secuencia) hasta dejar SESSION_RESERVE_BYTES
+// libres; la que se va a abrir aún no tiene fichero
+void SessionRecorder::makeRoom() {
+  while (LittleFS.totalBytes() - LittleFS.usedBytes() < SESSION_RESERVE_BYTES) {
+    bool found = false;
+    uint32_t oldest = 0;
+    File dir = LittleFS.open(SESSION_DIR);
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+      uint32_t sequence;
+      if (!sessionSequenceFromName(f.name(), sequence)) continue;
+      if (!found || sequence < oldest) oldest = sequence;
+      found = true;
+    }
+    dir.close();
+    if (!found) return;
+    char path[PATH_SIZE];
+    sessionPath(oldest, path);
+    if (!LittleFS.remove(path)) return;
+  }
+}
+
+// Única tarea que toca la flash: abre, escribe páginas enteras y cierra, en orden
+void SessionRecorder::writerTask(void *param) {
+  SessionRecorder *self = (SessionRecorder *)param;
+  File file;
+  Command command;
+
+  for (;;) {
+    xQueueReceive(self->commands, &command, portMAX_DELAY);
+    switch (command.kind) {
+      case CMD_OPEN: {
+        if (file) file.close();
+        self->makeRoom();
+        char path[PATH_SIZE];
+        sessionPath(command.sequence, path);
+        file = LittleFS.open(path, FILE_WRITE);
+        if (!file) self->errors++;
+        break;
+      }
+      case CMD_PAGE:
+        if (!file || file.write(self->pager.page(command.page), SESSION_PAGE_SIZE) != SESSION_PAGE_SIZE) {
+          self->errors++;
+        }
+        self->pager.release(command.page);
+        break;
+      case CMD_CLOSE:
+        if (file) file.close();
+        break;
+    }
+  }
+}
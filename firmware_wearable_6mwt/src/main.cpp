@@ -1,114 +1,876 @@
 #include <Arduino.h>
 #include <Adafruit_LSM9DS1.h>
 #include <Adafruit_Sensor.h>
-#include <math.h>
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include <SpscRing.h>
+#include <StepDetector.h>
+#include <StrideEstimator.h>
+#include <RawStreamPacket.h>
+#include <StepEventPacket.h>
+#include <StepEventLog.h>
+#include <NotifyScheduler.h>
+#include <TimingProfile.h>
+#include <TimingPacket.h>
+#include <CadencePacket.h>
+#include <LapPacket.h>
+#include <SensorConfigPacket.h>
+#include <RecordingPacket.h>
+#include <ReprocessPacket.h>
+#include <TurnDetector.h>
+#include <GravityEstimator.h>
+#include <BlockKernels.h>
+#include <HistoryBuffer.h>
+#include <StepReprocessor.h>
+#include <esp_heap_caps.h>
+#include <math.h>
+#include "Lsm9ds1Fifo.h"
+#include "BleLinkPolicy.h"
+#include "ConfigStore.h"
+#include "SessionRecorder.h"
+#include "SessionFileStore.h"
 
 // --- Configuración del Sensor---
 Adafruit_LSM9DS1 lsm = Adafruit_LSM9DS1();
+Lsm9ds1Fifo imuFifo; // Acceso directo a registros: lecturas en ráfaga y FIFO
+
+// Modo de adquisición: 1 = ráfagas desde la FIFO del LSM9DS1, 0 = una muestra por loop()
+#ifndef ACCEL_FIFO_MODE
+#define ACCEL_FIFO_MODE 1
+#endif
+
+// Giros de 180° con el giroscopio (vueltas del pasillo): 1 activa el giroscopio y la
+// característica de vueltas; 0 deja solo el acelerómetro
+#ifndef GYRO_TURN_MODE
+#define GYRO_TURN_MODE 0
+#endif
+// Señal del detector: 0 = módulo², 1 = componente vertical² con la gravedad estimada
+// (en coma fija; con GYRO_TURN_MODE la estimación se apoya también en el giroscopio)
+#ifndef VERTICAL_ACCEL_MODE
+#define VERTICAL_ACCEL_MODE 0
+#endif
+
+#if GYRO_TURN_MODE && !ACCEL_FIFO_MODE
+#error "GYRO_TURN_MODE necesita ACCEL_FIFO_MODE: el giroscopio se lee desde la FIFO"
+#endif
+
+// --- Configuración Persistente ---
+// Umbrales, rebote, zancada, sensor, nombre y UUIDs: se leen de NVS una vez en setup()
+// y la tablet los cambia con la característica de configuración (DeviceConfigPacket.h)
+ConfigStore configStore;
+DeviceConfig deviceConfig = ConfigStore::defaults();
+DeviceConfig requestedDeviceConfig;
+volatile bool deviceConfigRequested = false;
+
+#if ACCEL_FIFO_MODE
+// Pin del XIAO conectado a INT1_A/G del LSM9DS1 (aviso de watermark de la FIFO)
+#ifndef IMU_INT1_PIN
+#define IMU_INT1_PIN D1
+#endif
+
+// --- Tareas de Adquisición y Detección ---
+// El stack Bluedroid corre en el núcleo 0, así que la adquisición va sola en el núcleo 1
+// y la detección y las notificaciones BLE comparten el núcleo 0 con el stack.
+const BaseType_t ACQUISITION_CORE = 1;
+const BaseType_t DETECTION_CORE = 0;
+const UBaseType_t ACQUISITION_PRIORITY = 5;
+const UBaseType_t DETECTION_PRIORITY = 3;
+const UBaseType_t STREAM_PRIORITY = 2; // Por debajo de la detección: nunca la retrasa
+
+TaskHandle_t acquisitionTaskHandle = NULL;
+TaskHandle_t detectionTaskHandle = NULL;
+// Cuatro ráfagas completas de margen (~1 s a 119 Hz) si la detección se retrasa por el BLE
+SpscRing<RawSample, 4 * Lsm9ds1Fifo::FIFO_SLOTS> sampleRing;
+#if GYRO_TURN_MODE
+// Giroscopio de cada muestra de sampleRing, con la misma capacidad. La adquisición lo
+// mete después de la muestra y la detección lo saca antes, así que si la muestra cupo
+// su giroscopio también cabe y las dos colas avanzan a la par.
+SpscRing<RawGyroSample, 4 * Lsm9ds1Fifo::FIFO_SLOTS> gyroRing;
+#endif
+
+// --- Streaming de Datos Crudos ---
+// Copia de las muestras para la característica de streaming: una cola propia hace que
+// un enlace lento solo pierda muestras del streaming, nunca de la detección.
+TaskHandle_t streamTaskHandle = NULL;
+SpscRing<RawSample, 8 * Lsm9ds1Fifo::FIFO_SLOTS> streamRing;
+volatile bool rawStreamEnabled = false;
+
+void IRAM_ATTR onImuWatermark();
+void acquisitionTask(void *param);
+void detectionTask(void *param);
+void streamTask(void *param);
+#endif
+
+// --- Instrumentación de Tiempos ---
+// Histogramas log-lineales (TimingProfile.h) de lo que tarda cada etapa, medido con el
+// contador de ciclos, y del jitter del intervalo real entre lecturas del sensor. Se
+// leen por la característica de tiempos, en resumen por la de diagnóstico y por serie
+// (115200 baudios: 'd' vuelca los histogramas y 'r' los vacía). Con
+// TIMING_INSTRUMENTATION = 0 las medidas desaparecen del binario al compilar.
+#ifndef TIMING_INSTRUMENTATION
+#define TIMING_INSTRUMENTATION 1
+#endif
+// Volcado periódico por serie en ms (0 = solo a petición)
+#ifndef TIMING_DUMP_PERIOD_MS
+#define TIMING_DUMP_PERIOD_MS 0
+#endif
+
+#if TIMING_INSTRUMENTATION
+enum TimingStage : uint8_t {
+  STAGE_SENSOR_READ,  // Lectura del sensor por I2C (una ráfaga de la FIFO o una muestra)
+  STAGE_DETECTION,    // Señal, historial y detector de un bloque o una muestra
+  STAGE_NOTIFY,       // Cada notify() de las notificaciones en vivo
+  TIMING_STAGES
+};
+const char *const TIMING_STAGE_NAMES[TIMING_STAGES] = {"lectura sensor", "detección", "notify()"};
+TimingProfile timingProfile(TIMING_STAGE_NAMES, TIMING_STAGES, 240); // setup() pone la real
+volatile uint8_t timingSelected = STAGE_SENSOR_READ; // Histograma que devuelve la característica
+const UBaseType_t TIMING_PRIORITY = 1;
+const BaseType_t TIMING_CORE = 1;
+uint32_t lastSampleCycles = 0; // Lectura anterior del sensor (0 = ninguna)
+void timingTask(void *param);
+
+// Intervalo real desde la lectura anterior del sensor frente al nominal
+void recordSampleInterval(uint32_t expectedUs) {
+  uint32_t now = cycleCount();
+  if (lastSampleCycles != 0) timingProfile.recordInterval(now - lastSampleCycles, expectedUs);
+  lastSampleCycles = now;
+}
+
+#define TIME_STAGE(stage) TimingScope timingScope(timingProfile, stage)
+#define TIME_SAMPLE_INTERVAL(expectedUs) recordSampleInterval(expectedUs)
+#define TIME_RESTART_INTERVAL() (lastSampleCycles = 0)
+#else
+#define TIME_STAGE(stage)
+#define TIME_SAMPLE_INTERVAL(expectedUs)
+#define TIME_RESTART_INTERVAL()
+#endif
 
 // --- Lógica de Detección de Pasos ---
-int stepCount = 0;
-const float ACCEL_THRESHOLD_HIGH = 12.0; 
-const float ACCEL_THRESHOLD_LOW = 9.5;
-bool highPeakDetected = false;
-unsigned long lastStepTime = 0;
-const int DEBOUNCE_TIME_MS = 350;
+// Umbrales y rebote por defecto en StepDetector.h, ya convertidos a cuentas² del ADC.
+// El filtro previo a los umbrales se diseña para el ritmo real al que llegan las muestras.
+#if ACCEL_FIFO_MODE
+const double DETECTION_RATE_HZ = ACCEL_SAMPLE_RATE_HZ;
+#else
+const double DETECTION_RATE_HZ = 50.0; // Una muestra por loop() con delay(20)
+#endif
+StepDetector stepDetector(StepDetector::defaultConfig(DETECTION_RATE_HZ));
+#if VERTICAL_ACCEL_MODE
+GravityEstimatorQ gravityEstimator(DETECTION_RATE_HZ);
+#endif
+
+// Longitud de cada paso y distancia acumulada, enviadas con cada evento de paso
+StrideEstimator strideEstimator;
+
+#if GYRO_TURN_MODE
+TurnDetector turnDetector(DETECTION_RATE_HZ);
+#endif
+
+// --- Configuración del Sensor en Tiempo de Ejecución ---
+// La tablet puede cambiar ODR, rango y watermark entre pruebas (formato en
+// SensorConfigPacket.h). Solo quien lee el sensor reprograma sus registros, y el
+// detector se reconfigura desde su propia tarea cuando ya ha procesado lo anterior.
+const Lsm9ds1Fifo::DataRate SENSOR_RATES[SENSOR_CONFIG_ODR_CODES] = {
+  Lsm9ds1Fifo::ODR_50HZ, Lsm9ds1Fifo::ODR_119HZ, Lsm9ds1Fifo::ODR_238HZ
+};
+const Lsm9ds1Fifo::AccelRange SENSOR_RANGES[SENSOR_CONFIG_RANGE_CODES] = {
+  Lsm9ds1Fifo::RANGE_2G, Lsm9ds1Fifo::RANGE_4G, Lsm9ds1Fifo::RANGE_8G, Lsm9ds1Fifo::RANGE_16G
+};
+SensorConfig sensorConfig = {1, 0, 0}; // La aplicada; setup() parte de deviceConfig.sensor
+SensorConfig requestedSensorConfig;
+volatile bool sensorConfigRequested = false;
+volatile bool detectorConfigPending = false;
+float accelMgPerCount = ACCEL_MG_PER_COUNT_2G; // Escala del rango aplicado, para peakMg
+
+bool applySensorConfig(const SensorConfig &config);
+void applyDetectorConfig(double rateHz);
+void publishSensorConfig();
+void publishDeviceConfig();
+
+// --- Grabación de Sesiones en Flash ---
+// Muestras crudas y eventos de paso de cada prueba en LittleFS (SessionRecorder.h).
+// Con SESSION_AUTO_RECORD la grabación empieza con el primer paso y termina tras
+// SESSION_IDLE_STOP_MS sin pasos; la tablet también puede empezarla y pararla, y las
+// que empieza ella solo terminan con su orden o al llegar a SessionRecorder::MAX_DURATION_MS,
+// con la que se dimensiona el sitio que se deja libre para cada sesión.
+#ifndef SESSION_AUTO_RECORD
+#define SESSION_AUTO_RECORD 1
+#endif
+const uint32_t SESSION_IDLE_STOP_MS = 30000;
+const UBaseType_t SESSION_WRITER_PRIORITY = 1; // La flash espera a todo lo demás
+const BaseType_t SESSION_WRITER_CORE = 0;      // Lejos de la adquisición
+
+SessionRecorder sessionRecorder;
+const uint8_t RECORDING_NO_COMMAND = 0xFF;
+volatile uint8_t recordingCommand = RECORDING_NO_COMMAND;
+bool sessionAutoStarted = false;
+
+// --- Historial en PSRAM ---
+// Los últimos HISTORY_MINUTES minutos de muestras crudas con la señal del detector y
+// sus pasos, en la PSRAM externa (HistoryBuffer.h). Se dimensiona para el ODR más alto;
+// sin PSRAM el wearable funciona igual, solo que sin historial.
+#ifndef HISTORY_MINUTES
+#define HISTORY_MINUTES 10
+#endif
+const size_t HISTORY_CAPACITY = (size_t)HISTORY_MINUTES * 60 * 238;
+HistoryBuffer historyBuffer;
+static_assert(StepDetector::BLOCK_SIZE <= HistoryBuffer::BLOCK,
+              "markStep busca el paso entre las últimas HistoryBuffer::BLOCK entradas");
+
+// --- Reprocesado de la Prueba ---
+// Al terminar cada sesión, o cuando lo pide la tablet, la detección se repite sobre el
+// historial con StepReprocessor (filtro de fase cero y selección global de picos) y se
+// publica el recuento y la distancia corregidos. La tarea va en el núcleo 1 con la
+// prioridad más baja: solo la interrumpe la adquisición y el núcleo 0 queda para el BLE.
+const UBaseType_t REPROCESS_PRIORITY = 1;
+const BaseType_t REPROCESS_CORE = 1;
+// La sesión automática empieza al detectar el primer paso, después de su pico: la
+// ventana empieza antes de la primera muestra grabada para incluirlo
+const uint32_t REPROCESS_LEAD_MS = 2000;
+
+struct ReprocessRequest {
+  bool lastSession;
+  uint32_t fromMs;
+  uint32_t toMs;
+};
+QueueHandle_t reprocessRequests = NULL; // Un hueco: la petición nueva sustituye a la pendiente
+// Ventana de la última sesión en instantes de muestra, como los busca el historial
+volatile uint32_t lastSessionFromMs = 0;
+volatile uint32_t lastSessionToMs = 0;
+void reprocessTask(void *param);
+void requestReprocess(const ReprocessRequest &request);
+
+// --- Descarga de Sesiones ---
+// Servicio propio de transferencia de ficheros (protocolo en FileTransferProtocol.h):
+// lista las sesiones y las envía en fragmentos del tamaño del MTU con créditos y CRC.
+// Una tarea de baja prioridad lee la flash y notifica; el stack BLE solo encola.
+const UBaseType_t TRANSFER_PRIORITY = 1;
+const BaseType_t TRANSFER_CORE = 0;
+const size_t TRANSFER_CHUNKS_PER_BATCH = 8; // Entre tanda y tanda se cede el núcleo
+TaskHandle_t transferTaskHandle = NULL;
+void transferTask(void *param);
 
 // --- Configuración del Servidor BLE ---
 BLEServer* pServer = NULL;
 BLECharacteristic* pDistanceCharacteristic = NULL;
+BLECharacteristic* pRawStreamCharacteristic = NULL;
+BLECharacteristic* pStepEventsCharacteristic = NULL;
+BLECharacteristic* pDiagnosticsCharacteristic = NULL;
+BLECharacteristic* pCadenceCharacteristic = NULL;
+BLECharacteristic* pLapsCharacteristic = NULL;
+BLECharacteristic* pSensorConfigCharacteristic = NULL;
+BLECharacteristic* pDeviceConfigCharacteristic = NULL;
+BLECharacteristic* pRecordingCharacteristic = NULL;
+BLECharacteristic* pReprocessCharacteristic = NULL;
+BLECharacteristic* pTimingCharacteristic = NULL;
+BLECharacteristic* pFileControlCharacteristic = NULL;
+BLECharacteristic* pFileDataCharacteristic = NULL;
+BLE2902* pStepEventsCccd = NULL;
+BLE2902* pCadenceCccd = NULL;
 bool deviceConnected = false;
+uint16_t connId = 0;
+volatile uint16_t peerMtu = 23; // MTU por defecto hasta que la tablet negocie otro
+
+// MTU local máximo que se ofrece a la tablet (cabecera ATT de 3 bytes + 244 de datos)
+const uint16_t BLE_LOCAL_MTU = 247;
 
-// UUIDs únicos para el servicio y la característica.
-#define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
-#define STEPS_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+// UUIDs del servicio y de las características: el del servicio y la base de las
+// características salen de deviceConfig (por defecto 4fafc201-1fb5-459e-8fcc-c5c9c331914b
+// y beb5483e-36e1-4688-b7f5-ea07361b26xx); cada característica pone su último byte.
+const uint8_t STEPS_CHARACTERISTIC_SUFFIX = 0xa8;
+const uint8_t RAW_STREAM_CHARACTERISTIC_SUFFIX = 0xa9;
+const uint8_t STEP_EVENTS_CHARACTERISTIC_SUFFIX = 0xaa;
+const uint8_t DIAGNOSTICS_CHARACTERISTIC_SUFFIX = 0xab;
+const uint8_t CADENCE_CHARACTERISTIC_SUFFIX = 0xac;
+const uint8_t LAPS_CHARACTERISTIC_SUFFIX = 0xad;
+const uint8_t SENSOR_CONFIG_CHARACTERISTIC_SUFFIX = 0xae;
+const uint8_t DEVICE_CONFIG_CHARACTERISTIC_SUFFIX = 0xaf;
+const uint8_t RECORDING_CHARACTERISTIC_SUFFIX = 0xb0;
+const uint8_t REPROCESS_CHARACTERISTIC_SUFFIX = 0xb1;
+const uint8_t TIMING_CHARACTERISTIC_SUFFIX = 0xb2;
+// Servicio de descarga: su UUID y los de sus características salen de la misma base
+const uint8_t FILE_SERVICE_SUFFIX = 0xc0;
+const uint8_t FILE_CONTROL_CHARACTERISTIC_SUFFIX = 0xc1;
+const uint8_t FILE_DATA_CHARACTERISTIC_SUFFIX = 0xc2;
+const uint32_t FILE_SERVICE_HANDLES = 8;
 
+// Handles de atributo del servicio: uno por el servicio, dos por característica y uno
+// por descriptor. El valor por defecto de Bluedroid (15) ya no alcanza.
+const uint32_t SERVICE_HANDLES = 48;
+
+BLEUUID serviceUuid() {
+  char text[37];
+  formatUuid(deviceConfig.serviceUuid, text);
+  return BLEUUID(text);
+}
+
+BLEUUID characteristicUuid(uint8_t suffix) {
+  uint8_t uuid[UUID_SIZE];
+  memcpy(uuid, deviceConfig.characteristicUuidBase, UUID_SIZE);
+  uuid[UUID_SIZE - 1] = suffix;
+  char text[37];
+  formatUuid(uuid, text);
+  return BLEUUID(text);
+}
+
+// --- Parámetros del Enlace ---
+// Se considera que hay una prueba en curso mientras haya pasos recientes o streaming
+BleLinkPolicy linkPolicy;
+const uint32_t LINK_ACTIVE_HOLD_MS = 10000;
+
+// --- Notificaciones en Vivo ---
+// La detección no llama a notify(): deja cada paso, cadencia o giro en la cola de
+// notifyScheduler y una tarea propia notifica. Lo pendiente se combina (NotifyScheduler.h)
+// y sale junto como mucho NOTIFY_LATENCY_BUDGET_MS después de la actualización más antigua.
+#ifndef NOTIFY_LATENCY_BUDGET_MS
+#define NOTIFY_LATENCY_BUDGET_MS 250
+#endif
+const UBaseType_t NOTIFY_PRIORITY = 2; // Por debajo de la detección, como el streaming
+const BaseType_t NOTIFY_CORE = 0;      // Junto al stack BLE
+const uint32_t REPLAY_BATCH_INTERVAL_MS = 20;
+NotifyScheduler notifyScheduler(NOTIFY_LATENCY_BUDGET_MS);
+TaskHandle_t notifyTaskHandle = NULL;
+void notifyTask(void *param);
+
+// --- Eventos de Paso Agrupados ---
+// Se acumulan varios pasos por notificación y se envían al llenar el paquete o al
+// vencer el presupuesto de latencia. Todo este estado es de la tarea de notificaciones.
+StepEventPacker stepEventPacker;
+
+// Historial para reenviar, con su marca de tiempo original, los pasos que la tablet no
+// recibió (desconexión, suscripción tardía o cola de notificaciones llena). Lo escribe
+// la detección y lo lee esta tarea. 1024 eventos (20 KB) cubren de sobra seis minutos.
+StepEventLog<1024> stepEventLog;
+uint32_t deliveredSteps = 0;   // Último paso notificado con la tablet suscrita
+uint32_t packedLastSteps = 0;  // Último paso dentro del paquete pendiente
+volatile bool stepReplayRequested = false;
+uint32_t replayNextStep = 0;   // Siguiente paso a reenviar (0 = sin reenvío en curso)
+const uint8_t REPLAY_PACKETS_PER_BATCH = 4; // Para no saturar los buffers del stack BLE
+
+// --- Cadencia en Vivo ---
+// La estimación se renueva con cada ráfaga; a la tablet le basta una vez por segundo
+uint32_t lastCadenceNotifyMs = 0;
+const uint32_t CADENCE_NOTIFY_MS = 1000;
+
+
+// Notificaciones del servicio de descarga; sin conexión no se envía nada
+class BleTransferLink: public FileTransferLink {
+    size_t maxPacket() override { return peerMtu - 3; }
+
+    bool sendControl(const uint8_t *data, size_t len) override {
+      return notifyTransfer(pFileControlCharacteristic, data, len);
+    }
+
+    bool sendData(const uint8_t *data, size_t len) override {
+      return notifyTransfer(pFileDataCharacteristic, data, len);
+    }
+
+    static bool notifyTransfer(BLECharacteristic *characteristic, const uint8_t *data, size_t len) {
+      if (!deviceConnected) return false;
+      characteristic->setValue((uint8_t*)data, len);
+      characteristic->notify();
+      return true;
+    }
+};
+
+SessionFileStore sessionFileStore(sessionRecorder);
+BleTransferLink transferLink;
+FileTransferServer fileTransferServer(sessionFileStore, transferLink);
 
 // Clase para manejar los callbacks de conexión y desconexión del servidor BLE
 class MyServerCallbacks: public BLEServerCallbacks {
-    void onConnect(BLEServer* pServer) {
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
       deviceConnected = true;
+      connId = param->connect.conn_id;
+      // El intercambio de MTU lo inicia siempre la tablet (cliente GATT); el wearable ofrece
+      // BLE_LOCAL_MTU y aquí recoge lo ya acordado, onMtuChanged() recoge los cambios posteriores
+      peerMtu = pServer->getPeerMTU(connId);
+      linkPolicy.onConnect(param->connect.remote_bda);
     }
 
     void onDisconnect(BLEServer* pServer) {
       deviceConnected = false;
+      peerMtu = 23;
+      linkPolicy.onDisconnect();
+      // Una descarga a medias se cancela; el cliente la reanuda desde su último offset
+      const uint8_t abort = FT_OP_ABORT;
+      if (fileTransferServer.enqueue(&abort, 1)) xTaskNotifyGive(transferTaskHandle);
+#if ACCEL_FIFO_MODE
+      rawStreamEnabled = false; // El streaming se vuelve a pedir explícitamente al reconectar
+#endif
       pServer->getAdvertising()->start(); // Reiniciar el "anuncio" para que se pueda volver a encontrar
     }
+
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+      peerMtu = param->mtu.mtu;
+    }
+};
+
+// Al (re)activar las notificaciones de eventos se reenvían los pasos que faltan
+class StepEventsCccdCallbacks: public BLEDescriptorCallbacks {
+    void onWrite(BLEDescriptor* pDescriptor) {
+      if (((BLE2902*)pDescriptor)->getNotifications()) {
+        stepReplayRequested = true;
+        xTaskNotifyGive(notifyTaskHandle);
+      }
+    }
+};
+
+// El valor de diagnóstico se construye en el momento de cada lectura
+class DiagnosticsCallbacks: public BLECharacteristicCallbacks {
+    void onRead(BLECharacteristic* pCharacteristic) {
+      uint8_t value[128];
+      TlvWriter diag(value, sizeof(value));
+      linkPolicy.writeDiagnostics(diag, peerMtu);
+      notifyScheduler.writeDiagnostics(diag);
+#if TIMING_INSTRUMENTATION
+      timingProfile.writeDiagnostics(diag);
+#endif
+      historyBuffer.writeDiagnostics(diag);
+      pCharacteristic->setValue(value, diag.size());
+    }
+};
+
+// Una escritura válida queda pendiente hasta que la aplica la tarea que lee el sensor;
+// las inválidas se ignoran y la lectura sigue devolviendo la configuración vigente
+class SensorConfigCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      SensorConfig config;
+      if (!parseSensorConfig(pCharacteristic->getData(), pCharacteristic->getLength(), config)) return;
+      requestedSensorConfig = config;
+      sensorConfigRequested = true;
+#if ACCEL_FIFO_MODE
+      xTaskNotifyGive(acquisitionTaskHandle);
+#endif
+    }
 };
 
+// La configuración escrita se valida aquí y se guarda fuera del callback del stack
+class DeviceConfigCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      DeviceConfig config;
+      if (!parseDeviceConfig(pCharacteristic->getData(), pCharacteristic->getLength(), config)) return;
+      requestedDeviceConfig = config;
+      deviceConfigRequested = true;
+    }
+};
+
+// Las peticiones solo se copian a la cola del servidor; las atiende transferTask()
+class FileControlCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      if (fileTransferServer.enqueue(pCharacteristic->getData(), pCharacteristic->getLength())) {
+        xTaskNotifyGive(transferTaskHandle);
+      }
+    }
+};
+
+// Empezar o parar la grabación lo hace la tarea de detección; la lectura da el estado
+class RecordingCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      if (pCharacteristic->getLength() != 1) return;
+      uint8_t command = pCharacteristic->getData()[0];
+      if (command == RECORDING_STOP || command == RECORDING_START) recordingCommand = command;
+    }
+
+    void onRead(BLECharacteristic* pCharacteristic) {
+      uint8_t value[RECORDING_PACKET_SIZE];
+      packRecordingStatus(value, sessionRecorder.recording(), sessionRecorder.sessionId(),
+                          sessionRecorder.droppedRecords(), sessionRecorder.writeErrors());
+      pCharacteristic->setValue(value, sizeof(value));
+    }
+};
+
+// La petición pasa a la tarea de reprocesado; la lectura da el último resultado
+class ReprocessCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      const uint8_t *data = pCharacteristic->getData();
+      size_t len = pCharacteristic->getLength();
+      ReprocessRequest request = {false, 0, 0};
+      if (len == 1 && data[0] == REPROCESS_LAST_SESSION) {
+        request.lastSession = true;
+      } else if (len == REPROCESS_WINDOW_WRITE_SIZE) {
+        request.fromMs = getLe32(data);
+        request.toMs = getLe32(data + 4);
+      } else {
+        return;
+      }
+      requestReprocess(request);
+    }
+};
+
+#if TIMING_INSTRUMENTATION
+// Una escritura elige el histograma de las lecturas siguientes (una etapa, o
+// TIMING_STAGES para el jitter) o los vacía todos
+class TimingCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      if (pCharacteristic->getLength() != 1) return;
+      uint8_t command = pCharacteristic->getData()[0];
+      if (command == TIMING_RESET) {
+        timingProfile.reset();
+      } else if (command < TIMING_STAGES) {
+        timingSelected = command;
+      } else if (command == TIMING_STAGES) {
+        timingSelected = TIMING_STAGES; // Jitter del intervalo entre muestras
+      }
+    }
+
+    void onRead(BLECharacteristic* pCharacteristic) {
+      static uint8_t value[TIMING_MAX_PACKET_SIZE]; // Demasiado para la pila del stack BLE
+      size_t len = timingProfile.packHistogram(value, sizeof(value), timingSelected);
+      pCharacteristic->setValue(value, len);
+    }
+};
+#endif
+
+// Eventos GAP (parámetros de conexión y PHY acordados) para la política del enlace
+void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  linkPolicy.handleGapEvent(event, param);
+}
+
+#if ACCEL_FIFO_MODE
+// Escribir 0x01 en la característica de streaming lo activa y 0x00 lo detiene
+class RawStreamCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      if (pCharacteristic->getLength() < 1) return;
+      rawStreamEnabled = pCharacteristic->getData()[0] != 0;
+    }
+};
+#endif
+
 void setup() {
+  // Configuración guardada: un solo blob de NVS, antes de tocar el sensor y el BLE
+  configStore.load(deviceConfig);
+
+#if TIMING_INSTRUMENTATION
+  Serial.begin(115200);
+  timingProfile.setCpuMhz(getCpuFrequencyMhz());
+  timingProfile.calibrate(); // Coste de las propias medidas, antes de arrancar nada más
+#endif
+
   // Inicialización del sensor
   if (!lsm.begin()) {
     while (1) { delay(10); }
   }
   
-  // Solo se inicializa el acelerómetro (no magnetómetro ni giroscopio)
+  // Solo se inicializa el acelerómetro (no magnetómetro ni giroscopio); con GYRO_TURN_MODE
+  // el giroscopio lo enciende imuFifo.begin(), que ya configura la FIFO
   lsm.setupAccel(lsm.LSM9DS1_ACCELRANGE_2G);
 
+#if ACCEL_FIFO_MODE
+  // La FIFO se llena sola al ODR configurado; la tarea de adquisición la vacía al llegar al watermark
+  if (!imuFifo.begin(Lsm9ds1Fifo::ODR_119HZ, deviceConfig.sensor.watermark, GYRO_TURN_MODE != 0)) {
+    while (1) { delay(10); }
+  }
+#else
+  if (!imuFifo.begin(Lsm9ds1Fifo::ODR_119HZ, 0)) {
+    while (1) { delay(10); }
+  }
+#endif
+  // ODR y rango guardados, y las constantes del detector que dependen de ellos
+  if (!applySensorConfig(deviceConfig.sensor)) {
+    while (1) { delay(10); }
+  }
+#if ACCEL_FIFO_MODE
+  applyDetectorConfig(1000000.0 / imuFifo.samplePeriodUs());
+#else
+  applyDetectorConfig(DETECTION_RATE_HZ);
+#endif
+
+  // Historial en PSRAM (~2.3 MB con 10 minutos); sin ella queda desactivado
+  if (psramFound()) {
+    HistoryEntry *storage = (HistoryEntry*)heap_caps_malloc(HISTORY_CAPACITY * sizeof(HistoryEntry),
+                                                            MALLOC_CAP_SPIRAM);
+    historyBuffer.attach(storage, HISTORY_CAPACITY, true);
+  }
+
+  // Sin sistema de ficheros el wearable sigue funcionando, solo que no graba
+  sessionRecorder.begin(SESSION_WRITER_PRIORITY, SESSION_WRITER_CORE);
+
   delay(200); // Pequeña espera antes de iniciar BLE
 
   // ---Inicialización del BLE ---
   
   // 1. Inicializar el dispositivo BLE y ponerle un nombre
-  BLEDevice::init("WearableDistancia6MWT");
+  BLEDevice::init(deviceConfig.deviceName);
+  BLEDevice::setMTU(BLE_LOCAL_MTU); // Permite paquetes grandes si la tablet negocia el MTU
+  BLEDevice::setCustomGapHandler(onGapEvent);
 
   // 2. Crear el servidor BLE
   pServer = BLEDevice::createServer();
   pServer->setCallbacks(new MyServerCallbacks()); // Asignar callbacks
 
   // 3. Crear el servicio, usando el UUID definido
-  BLEService *pService = pServer->createService(SERVICE_UUID);
+  BLEService *pService = pServer->createService(serviceUuid(), SERVICE_HANDLES);
 
   // 4. Crear la característica para los pasos
   pDistanceCharacteristic = pService->createCharacteristic(
-                      STEPS_CHARACTERISTIC_UUID,
+                      characteristicUuid(STEPS_CHARACTERISTIC_SUFFIX),
                       BLECharacteristic::PROPERTY_READ |
                       BLECharacteristic::PROPERTY_NOTIFY // Propiedades: se puede leer y notificar cambios
                     );
 
   pDistanceCharacteristic->addDescriptor(new BLE2902()); // Descriptor estándar necesario para las notificaciones
 
+  // Característica de eventos de paso agrupados (formato en StepEventPacket.h)
+  pStepEventsCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(STEP_EVENTS_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pStepEventsCccd = new BLE2902();
+  pStepEventsCccd->setCallbacks(new StepEventsCccdCallbacks());
+  pStepEventsCharacteristic->addDescriptor(pStepEventsCccd);
+
+  // Característica de diagnóstico: secciones TLV (formato en TlvWriter.h)
+  pDiagnosticsCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(DIAGNOSTICS_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ
+                    );
+  pDiagnosticsCharacteristic->setCallbacks(new DiagnosticsCallbacks());
+
+  // Característica de cadencia estimada por autocorrelación (formato en CadencePacket.h)
+  pCadenceCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(CADENCE_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pCadenceCccd = new BLE2902();
+  pCadenceCharacteristic->addDescriptor(pCadenceCccd);
+
+#if GYRO_TURN_MODE
+  // Característica de vueltas: un evento por cada giro de 180° (formato en LapPacket.h)
+  pLapsCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(LAPS_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pLapsCharacteristic->addDescriptor(new BLE2902());
+#endif
+
+  // Característica de configuración del sensor (formato en SensorConfigPacket.h)
+  pSensorConfigCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(SENSOR_CONFIG_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_WRITE
+                    );
+  pSensorConfigCharacteristic->setCallbacks(new SensorConfigCallbacks());
+  publishSensorConfig();
+
+  // Característica de configuración persistente (formato en DeviceConfigPacket.h)
+  pDeviceConfigCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(DEVICE_CONFIG_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_WRITE
+                    );
+  pDeviceConfigCharacteristic->setCallbacks(new DeviceConfigCallbacks());
+  publishDeviceConfig();
+
+  // Característica de grabación de sesiones (formato en RecordingPacket.h)
+  pRecordingCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(RECORDING_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_WRITE
+                    );
+  pRecordingCharacteristic->setCallbacks(new RecordingCallbacks());
+
+  // Característica del reprocesado de la prueba (formato en ReprocessPacket.h)
+  pReprocessCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(REPROCESS_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_WRITE |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pReprocessCharacteristic->addDescriptor(new BLE2902());
+  pReprocessCharacteristic->setCallbacks(new ReprocessCallbacks());
+  uint8_t reprocessValue[REPROCESS_PACKET_SIZE];
+  packReprocessResult(reprocessValue, REPROCESS_IDLE, 0, 0, 0, 0, 0, 0);
+  pReprocessCharacteristic->setValue(reprocessValue, sizeof(reprocessValue));
+  reprocessRequests = xQueueCreate(1, sizeof(ReprocessRequest));
+  xTaskCreatePinnedToCore(reprocessTask, "reprocess", 4096, NULL,
+                          REPROCESS_PRIORITY, NULL, REPROCESS_CORE);
+
+#if TIMING_INSTRUMENTATION
+  // Característica de tiempos por etapa y jitter (formato en TimingPacket.h)
+  pTimingCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(TIMING_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_READ |
+                      BLECharacteristic::PROPERTY_WRITE
+                    );
+  pTimingCharacteristic->setCallbacks(new TimingCallbacks());
+  xTaskCreatePinnedToCore(timingTask, "timing", 4096, NULL,
+                          TIMING_PRIORITY, NULL, TIMING_CORE);
+#endif
+
+#if ACCEL_FIFO_MODE
+  // Característica de streaming de datos crudos (formato en RawStreamPacket.h)
+  pRawStreamCharacteristic = pService->createCharacteristic(
+                      characteristicUuid(RAW_STREAM_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_WRITE |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pRawStreamCharacteristic->addDescriptor(new BLE2902());
+  pRawStreamCharacteristic->setCallbacks(new RawStreamCallbacks());
+#endif
+
   // 5. Iniciar el servicio
   pService->start();
 
+  // Servicio de descarga de sesiones grabadas (protocolo en FileTransferProtocol.h)
+  BLEService *pFileService = pServer->createService(characteristicUuid(FILE_SERVICE_SUFFIX),
+                                                    FILE_SERVICE_HANDLES);
+  pFileControlCharacteristic = pFileService->createCharacteristic(
+                      characteristicUuid(FILE_CONTROL_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_WRITE |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pFileControlCharacteristic->addDescriptor(new BLE2902());
+  pFileControlCharacteristic->setCallbacks(new FileControlCallbacks());
+  pFileDataCharacteristic = pFileService->createCharacteristic(
+                      characteristicUuid(FILE_DATA_CHARACTERISTIC_SUFFIX),
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pFileDataCharacteristic->addDescriptor(new BLE2902());
+  xTaskCreatePinnedToCore(transferTask, "transfer", 4096, NULL,
+                          TRANSFER_PRIORITY, &transferTaskHandle, TRANSFER_CORE);
+  pFileService->start();
+
+  // Notificaciones en vivo: la tarea existe antes que cualquier productor y que la
+  // primera conexión
+  xTaskCreatePinnedToCore(notifyTask, "notify", 4096, NULL,
+                          NOTIFY_PRIORITY, &notifyTaskHandle, NOTIFY_CORE);
+
   // 6. Empezar a "anunciar" (advertising) el servicio para que la tablet lo pueda encontrar
   BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
-  pAdvertising->addServiceUUID(SERVICE_UUID);
+  pAdvertising->addServiceUUID(serviceUuid());
   pAdvertising->setScanResponse(true);
   BLEDevice::startAdvertising();
-  
+
+#if ACCEL_FIFO_MODE
+  // 7. Arrancar las tareas y, por último, la interrupción que despierta a la adquisición
+  xTaskCreatePinnedToCore(detectionTask, "detection", 4096, NULL,
+                          DETECTION_PRIORITY, &detectionTaskHandle, DETECTION_CORE);
+  xTaskCreatePinnedToCore(streamTask, "stream", 4096, NULL,
+                          STREAM_PRIORITY, &streamTaskHandle, DETECTION_CORE);
+  xTaskCreatePinnedToCore(acquisitionTask, "acquisition", 4096, NULL,
+                          ACQUISITION_PRIORITY, &acquisitionTaskHandle, ACQUISITION_CORE);
+
+  pinMode(IMU_INT1_PIN, INPUT);
+  imuFifo.enableWatermarkInterrupt();
+  attachInterrupt(digitalPinToInterrupt(IMU_INT1_PIN), onImuWatermark, RISING);
+#endif
 }
 
-void loop() {
-  lsm.read(); 
-  sensors_event_t accel, mag, gyro, temp;
-  lsm.getEvent(&accel, &mag, &gyro, &temp); 
-  
-  float ax = accel.acceleration.x;
-  float ay = accel.acceleration.y;
-  float az = accel.acceleration.z;
-  float magnitude = sqrt(ax * ax + ay * ay + az * az);
-  
-  unsigned long currentTime = millis();
-  
-  if (magnitude > ACCEL_THRESHOLD_HIGH && !highPeakDetected) {
-    if (currentTime - lastStepTime > DEBOUNCE_TIME_MS) {
-        highPeakDetected = true; 
+// Todas las notificaciones en vivo pasan por aquí para medir lo que tarda el stack
+void notifyLive(BLECharacteristic *characteristic) {
+  TIME_STAGE(STAGE_NOTIFY);
+  characteristic->notify();
+}
+
+// Envía el paquete de eventos pendiente; devuelve las notificaciones hechas
+size_t flushStepEvents() {
+  if (stepEventPacker.count() == 0) return 0;
+  size_t sent = 0;
+
+  // Sin tablet suscrita el paquete se descarta: los eventos siguen en stepEventLog
+  if (deviceConnected && pStepEventsCccd->getNotifications()) {
+    pStepEventsCharacteristic->setValue((uint8_t*)stepEventPacker.data(), stepEventPacker.size());
+    notifyLive(pStepEventsCharacteristic);
+    deliveredSteps = packedLastSteps;
+    sent = 1;
+  }
+  stepEventPacker.clear();
+  return sent;
+}
+
+size_t packStepEvent(const StepEvent &event) {
+  size_t sent = 0;
+  stepEventPacker.setMaxSize(peerMtu - 3);
+  if (!stepEventPacker.append(event)) {
+    sent = flushStepEvents();
+    stepEventPacker.append(event);
+  }
+  packedLastSteps = event.steps;
+  return sent;
+}
+
+// Deja la actualización para la tarea de notificaciones y la despierta. Devuelve false
+// si la cola estaba llena; el planificador la cuenta en DIAG_TAG_NOTIFY.
+bool postNotify(NotifyUpdate &update) {
+  update.queuedMs = millis();
+  bool queued = notifyScheduler.post(update);
+  xTaskNotifyGive(notifyTaskHandle);
+  return queued;
+}
+
+void queueStepEvent(const RawSample &sample) {
+  NotifyUpdate update;
+  update.kind = NOTIFY_STEP;
+  StepEvent &event = update.step;
+  event.t_ms = sample.t_ms;
+  event.steps = stepDetector.steps();
+  // Solo una raíz por paso, no por muestra
+  event.peakMg = (uint16_t)min(sqrtf((float)stepDetector.lastPeakSq()) * accelMgPerCount, 65535.0F);
+  uint32_t interval = stepDetector.lastIntervalMs();
+  event.intervalMs = (interval == 0 || interval > 0xFFFF) ? 0xFFFF : (uint16_t)interval;
+  event.strideMm = strideEstimator.onStep(stepDetector.lastPeakSq(), stepDetector.lastTroughSq());
+  event.distanceMm = strideEstimator.distanceMm();
+
+  sessionRecorder.appendStep(event);
+  // Al historial antes de encolar: si la cola está llena el evento no se pierde, se
+  // reenvía desde el historial por orden
+  stepEventLog.append(event);
+  if (!postNotify(update)) {
+    stepReplayRequested = true;
+  }
+}
+
+// Reenvía, en tandas de pocos paquetes, los eventos posteriores al último entregado;
+// devuelve true si el reenvío sigue en curso
+bool serviceStepReplay() {
+  if (stepReplayRequested) {
+    stepReplayRequested = false;
+    stepEventPacker.clear(); // Lo pendiente también está en el historial
+    replayNextStep = max(deliveredSteps + 1, stepEventLog.oldest());
+  }
+  if (replayNextStep == 0) return false;
+
+  uint8_t packets = 0;
+  StepEvent event;
+  while (replayNextStep <= stepEventLog.newest()) {
+    if (stepEventPacker.full()) {
+      if (packets == REPLAY_PACKETS_PER_BATCH) return true;
+      flushStepEvents();
+      packets++;
     }
+    if (!stepEventLog.read(replayNextStep, event)) {
+      // Sobrescrito mientras se reenviaba: se sigue por el más antiguo que queda
+      replayNextStep = stepEventLog.oldest();
+      continue;
+    }
+    packStepEvent(event);
+    replayNextStep++;
   }
-  
-  if (highPeakDetected && magnitude < ACCEL_THRESHOLD_LOW) {
-    // Si detecta un paso, incrementa el contador Y la distancia
-    stepCount++;
-    lastStepTime = currentTime;
-    highPeakDetected = false; 
-
-    // --- LÓGICA DE NOTIFICACIÓN BLE ---
-    if (deviceConnected) {
+  flushStepEvents();
+  replayNextStep = 0;
+  return false;
+}
+
+// Envíos de la tarea de notificaciones (interfaz Sink de NotifyScheduler). Los valores
+// se actualizan siempre, para que una lectura dé lo último aunque no haya suscripción.
+class BleNotifySink {
+  public:
+    size_t addStep(const StepEvent &event) {
+      // Durante un reenvío el evento nuevo sale por orden desde el historial, y lo que
+      // quede en la cola de lo ya reenviado no se repite
+      if (replayNextStep != 0 || event.steps <= packedLastSteps) return 0;
+      return packStepEvent(event);
+    }
+
+    // La característica original de 4 bytes se mantiene por compatibilidad con la app
+    size_t sendSteps(uint32_t stepCount) {
+      size_t sent = replayNextStep == 0 ? flushStepEvents() : 0;
       // Convertir el entero 'stepCount' a un array de 4 bytes
       // El formato "Little Endian" es el estándar en BLE
       uint8_t data_to_send[4];
@@ -116,12 +878,501 @@ void loop() {
       data_to_send[1] = (stepCount >> 8) & 0xFF;
       data_to_send[2] = (stepCount >> 16) & 0xFF;
       data_to_send[3] = (stepCount >> 24) & 0xFF;
-      
-      // Enviar los 4 bytes del entero
       pDistanceCharacteristic->setValue(data_to_send, 4);
-      pDistanceCharacteristic->notify();
+      if (deviceConnected) {
+        notifyLive(pDistanceCharacteristic);
+        sent++;
+      }
+      return sent;
+    }
+
+    size_t sendCadence(const uint8_t *value) {
+      pCadenceCharacteristic->setValue((uint8_t*)value, CADENCE_PACKET_SIZE);
+      if (!deviceConnected || !pCadenceCccd->getNotifications()) return 0;
+      notifyLive(pCadenceCharacteristic);
+      return 1;
+    }
+
+    size_t sendLap(const uint8_t *value) {
+      if (pLapsCharacteristic == NULL) return 0;
+      pLapsCharacteristic->setValue((uint8_t*)value, LAP_PACKET_SIZE);
+      if (!deviceConnected) return 0;
+      notifyLive(pLapsCharacteristic);
+      return 1;
+    }
+};
+
+// Publica la cadencia y su periodicidad; la lectura siempre devuelve la última
+void updateCadence(uint32_t now) {
+  if (now - lastCadenceNotifyMs < CADENCE_NOTIFY_MS) return;
+  lastCadenceNotifyMs = now;
+
+  const CadenceEstimator &cadence = stepDetector.cadence();
+  NotifyUpdate update;
+  update.kind = NOTIFY_CADENCE;
+  packCadence(update.cadence, cadence.cadenceX10(), (uint8_t)(cadence.confidence() * 100 + 0.5F),
+              stepDetector.rejectedPeaks());
+  postNotify(update);
+}
+
+// Intervalo corto mientras la prueba está en curso, largo en reposo
+void updateLinkPolicy(uint32_t now) {
+  bool active = stepDetector.steps() > 0 && now - stepDetector.lastStepTime() < LINK_ACTIVE_HOLD_MS;
+#if ACCEL_FIFO_MODE
+  active = active || rawStreamEnabled;
+#endif
+  if (deviceConnected) linkPolicy.update(active);
+}
+
+// Programa ODR, rango y watermark pedidos; sin FIFO el watermark se queda en 0
+bool applySensorConfig(const SensorConfig &config) {
+#if ACCEL_FIFO_MODE
+  uint8_t watermark = config.watermark;
+#else
+  uint8_t watermark = 0;
+#endif
+  if (!imuFifo.configure(SENSOR_RATES[config.odrCode], SENSOR_RANGES[config.rangeCode], watermark)) {
+    return false;
+  }
+  sensorConfig = config;
+  sensorConfig.watermark = watermark;
+  return true;
+}
+
+// Recalcula para el ODR y el rango aplicados las constantes que antes salían de los
+// valores fijos: umbrales en cuentas², filtro, cadencia, gravedad, giros y zancada.
+// Umbrales, rebote, modos y constante de zancada vienen de deviceConfig.
+// Pasos y distancia se conservan; las vueltas vuelven a cero con el detector de giros.
+void applyDetectorConfig(double rateHz) {
+  float mgPerCount = Lsm9ds1Fifo::mgPerCount(imuFifo.range());
+  float ms2PerCount = mgPerCount / 1000.0F * 9.80665F;
+  StepDetector::Config config = StepDetector::defaultConfig(rateHz, ms2PerCount);
+  config.highThresholdSq = squaredCounts(deviceConfig.thresholdHighCms2 / 100.0F, ms2PerCount);
+  config.lowThresholdSq = squaredCounts(deviceConfig.thresholdLowCms2 / 100.0F, ms2PerCount);
+  config.debounceMs = deviceConfig.debounceMs;
+  config.filterEnabled = (deviceConfig.flags & DEVICE_CONFIG_FILTER) != 0;
+  config.adaptive = (deviceConfig.flags & DEVICE_CONFIG_ADAPTIVE) != 0;
+  config.cadenceGate = (deviceConfig.flags & DEVICE_CONFIG_CADENCE_GATE) != 0;
+  stepDetector.configure(config);
+  strideEstimator.setScale(ms2PerCount);
+  strideEstimator.setK(deviceConfig.strideKx1000 / 1000.0F);
+#if VERTICAL_ACCEL_MODE
+  gravityEstimator.setSampleRate(rateHz);
+#endif
+#if GYRO_TURN_MODE
+  turnDetector.setSampleRate(rateHz);
+#endif
+  accelMgPerCount = mgPerCount;
+}
+
+// La lectura de cada característica de configuración devuelve la vigente
+void publishSensorConfig() {
+  uint8_t value[SENSOR_CONFIG_PACKET_SIZE];
+  packSensorConfig(value, sensorConfig);
+  pSensorConfigCharacteristic->setValue(value, sizeof(value));
+}
+
+void publishDeviceConfig() {
+  uint8_t value[DEVICE_CONFIG_PACKET_SIZE];
+  packDeviceConfig(value, deviceConfig);
+  pDeviceConfigCharacteristic->setValue(value, sizeof(value));
+}
+
+// Guarda la configuración que escribió la tablet y aplica en vivo sensor y detector por
+// el mismo camino que la característica del sensor. Nombre y UUIDs se anuncian a
+// partir del siguiente arranque.
+void serviceDeviceConfig() {
+  if (!deviceConfigRequested) return;
+  deviceConfigRequested = false;
+  deviceConfig = requestedDeviceConfig;
+  configStore.save(deviceConfig); // Si la NVS falla, la configuración vale hasta reiniciar
+  publishDeviceConfig();
+  requestedSensorConfig = deviceConfig.sensor;
+  sensorConfigRequested = true;
+#if ACCEL_FIFO_MODE
+  xTaskNotifyGive(acquisitionTaskHandle);
+#endif
+}
+
+// Órdenes de la tablet y cierre automático de la sesión en curso
+void serviceRecording(uint32_t now) {
+  uint8_t command = recordingCommand;
+  recordingCommand = RECORDING_NO_COMMAND;
+  if (command == RECORDING_START && !sessionRecorder.recording()) {
+    sessionRecorder.start(now, sensorConfig);
+    sessionAutoStarted = false;
+  }
+  if (!sessionRecorder.recording()) return;
+
+  uint32_t lastActivity = max(stepDetector.lastStepTime(), sessionRecorder.startTime());
+  bool idle = sessionAutoStarted && now - lastActivity > SESSION_IDLE_STOP_MS;
+  if (command == RECORDING_STOP || idle || now - sessionRecorder.startTime() > SessionRecorder::MAX_DURATION_MS) {
+    sessionRecorder.stop(now, stepDetector.steps(), strideEstimator.distanceMm());
+    // Una sesión sin muestras no tiene nada que reprocesar
+    if (!sessionRecorder.hasSamples()) return;
+    uint32_t firstMs = sessionRecorder.firstSampleTime();
+    lastSessionFromMs = firstMs > REPROCESS_LEAD_MS ? firstMs - REPROCESS_LEAD_MS : 0;
+    lastSessionToMs = sessionRecorder.lastSampleTime();
+    ReprocessRequest request = {true, 0, 0};
+    requestReprocess(request);
+  }
+}
+
+// Encola el evento, con el total acumulado, cada vez que el detector completa un paso
+void onStepDetected(const RawSample &sample) {
+#if SESSION_AUTO_RECORD
+  if (!sessionRecorder.recording()) sessionAutoStarted = sessionRecorder.start(sample.t_ms, sensorConfig);
+#endif
+  queueStepEvent(sample);
+  historyBuffer.markStep(sample.t_ms);
+}
+
+#if GYRO_TURN_MODE
+// Cada giro se notifica en cuanto lo saca la tarea de notificaciones: son pocos (uno
+// por largo de pasillo)
+void onTurnDetected(const RawSample &sample) {
+  NotifyUpdate update;
+  update.kind = NOTIFY_LAP;
+  packLap(update.lap, (uint16_t)turnDetector.turns(), sample.t_ms,
+          (int16_t)turnDetector.lastTurnDegrees(), stepDetector.steps());
+  postNotify(update);
+}
+#endif
+
+// Núcleo 0: única tarea que notifica pasos, cadencia y giros. Duerme hasta que llega
+// una actualización o vence lo pendiente; durante un reenvío despierta cada pocos ms.
+void notifyTask(void *param) {
+  BleNotifySink sink;
+  for (;;) {
+    uint32_t wait = notifyScheduler.service(millis(), sink);
+    if (serviceStepReplay()) wait = min(wait, REPLAY_BATCH_INTERVAL_MS);
+    ulTaskNotifyTake(pdTRUE, wait == NotifyScheduler::IDLE ? portMAX_DELAY : max<TickType_t>(pdMS_TO_TICKS(wait), 1));
+  }
+}
+
+void requestReprocess(const ReprocessRequest &request) {
+  if (reprocessRequests != NULL) xQueueOverwrite(reprocessRequests, &request);
+}
+
+void publishReprocessResult(uint8_t status, uint16_t elapsedMs, const StepReprocessor::Result &result) {
+  uint8_t value[REPROCESS_PACKET_SIZE];
+  packReprocessResult(value, status, elapsedMs, result.fromMs, result.toMs,
+                      result.liveSteps, result.steps, result.distanceMm);
+  pReprocessCharacteristic->setValue(value, sizeof(value));
+  if (deviceConnected) {
+    pReprocessCharacteristic->notify();
+  }
+}
+
+// Núcleo 1, prioridad mínima: reprocesa cada ventana pedida con memoria de trabajo en
+// PSRAM, que solo se reserva mientras dura el cálculo
+void reprocessTask(void *param) {
+  ReprocessRequest request;
+  for (;;) {
+    xQueueReceive(reprocessRequests, &request, portMAX_DELAY);
+    uint32_t fromMs = request.lastSession ? lastSessionFromMs : request.fromMs;
+    uint32_t toMs = request.lastSession ? lastSessionToMs : request.toMs;
+
+    StepReprocessor::Result result = {};
+    result.fromMs = fromMs;
+    result.toMs = toMs;
+    publishReprocessResult(REPROCESS_RUNNING, 0, result);
+
+    uint32_t started = millis();
+    uint32_t from = historyBuffer.indexAtTime(fromMs);
+    uint32_t to = historyBuffer.indexAtTime(toMs + 1);
+    if (from == historyBuffer.begin() && from > 0) {
+      // El principio de la ventana ya se sobrescribió: no se publica un recuento parcial
+      result.status = StepReprocessor::OVERWRITTEN;
+    } else {
+      size_t bytes = StepReprocessor::workspaceBytes(to > from ? to - from : 0);
+      void *workspace = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+      StepReprocessor reprocessor(StepReprocessor::defaultConfig(
+          accelMgPerCount / 1000.0F * 9.80665F, deviceConfig.strideKx1000 / 1000.0F));
+      result = reprocessor.run(historyBuffer, from, to, workspace, workspace != NULL ? bytes : 0);
+      heap_caps_free(workspace);
+    }
+    uint32_t elapsed = millis() - started;
+    publishReprocessResult(REPROCESS_FINISHED + result.status, (uint16_t)min<uint32_t>(elapsed, 0xFFFF), result);
+  }
+}
+
+#if TIMING_INSTRUMENTATION
+// Un histograma por serie: resumen y, por cubo no vacío, su rango y sus registros
+void dumpHistogram(const char *name, const LatencyHistogram &h, bool cycles) {
+  const char *unit = cycles ? "ciclos" : "us";
+  Serial.printf("%s: %u registros, min %u, p50 %u, p99 %u, max %u %s\n", name, (unsigned)h.count(),
+                (unsigned)h.min(), (unsigned)h.percentile(500), (unsigned)h.percentile(990),
+                (unsigned)h.max(), unit);
+  for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+    if (h.at(i) == 0) continue;
+    uint32_t low = LatencyHistogram::bucketLow(i);
+    if (cycles) {
+      Serial.printf("  %10u %s (%8u us) %8u\n", (unsigned)low, unit,
+                    (unsigned)timingProfile.toUs(low), (unsigned)h.at(i));
+    } else {
+      Serial.printf("  %10u %s %8u\n", (unsigned)low, unit, (unsigned)h.at(i));
+    }
+  }
+}
+
+void dumpTiming() {
+  Serial.printf("--- tiempos: CPU a %u MHz, sobrecarga %u + %u ciclos por medida ---\n",
+                timingProfile.cpuMhz(), (unsigned)timingProfile.readBiasCycles(),
+                (unsigned)timingProfile.recordCycles());
+  for (size_t i = 0; i < timingProfile.stages(); i++) {
+    dumpHistogram(timingProfile.stageName(i), timingProfile.stage(i), true);
+  }
+  const JitterMeter &jitter = timingProfile.jitter();
+  Serial.printf("jitter: nominal %u us, rms %u us, desviación de %d a %d us\n",
+                (unsigned)jitter.expectedUs(), (unsigned)jitter.rmsUs(),
+                (int)jitter.minDeviationUs(), (int)jitter.maxDeviationUs());
+  dumpHistogram("desviación absoluta", jitter.deviations(), false);
+}
+
+// Núcleo 1, prioridad mínima: atiende las órdenes del puerto serie y el volcado
+// periódico, para que escribir por serie no retrase a ninguna etapa medida
+void timingTask(void *param) {
+  uint32_t lastDumpMs = millis();
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+    while (Serial.available() > 0) {
+      int command = Serial.read();
+      if (command == 'd') dumpTiming();
+      if (command == 'r') timingProfile.reset();
+    }
+    if (TIMING_DUMP_PERIOD_MS > 0 && millis() - lastDumpMs >= TIMING_DUMP_PERIOD_MS) {
+      lastDumpMs = millis();
+      dumpTiming();
+    }
+  }
+}
+#endif
+
+// Atiende el servicio de descarga: mientras queden créditos sigue enviando por tandas,
+// y al agotarlos espera a que el cliente devuelva más
+void transferTask(void *param) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (fileTransferServer.service(TRANSFER_CHUNKS_PER_BATCH)) {
+      vTaskDelay(1);
+    }
+  }
+}
+
+#if ACCEL_FIFO_MODE
+// ISR del pin INT1: solo despierta a la tarea de adquisición, el I2C se hace fuera
+void IRAM_ATTR onImuWatermark() {
+  BaseType_t higherPriorityWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(acquisitionTaskHandle, &higherPriorityWoken);
+  portYIELD_FROM_ISR(higherPriorityWoken);
+}
+
+// Núcleo 1: vacía la FIFO en cada watermark y pasa las muestras a la detección
+void acquisitionTask(void *param) {
+  RawSample samples[Lsm9ds1Fifo::FIFO_SLOTS];
+#if GYRO_TURN_MODE
+  RawGyroSample gyroSamples[Lsm9ds1Fifo::FIFO_SLOTS];
+#endif
+  // Si se perdiese un flanco, el timeout evita que la FIFO se quede llena sin vaciar
+  TickType_t timeout = pdMS_TO_TICKS(2 * (imuFifo.watermark() * imuFifo.samplePeriodUs()) / 1000);
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, timeout);
+    if (sensorConfigRequested) {
+      sensorConfigRequested = false;
+      // Lo que quedase en la FIFO se pierde al reprogramarla; lo ya encolado se procesa
+      // con la configuración anterior antes de que la detección cambie la suya
+      if (applySensorConfig(requestedSensorConfig)) {
+        timeout = pdMS_TO_TICKS(2 * (imuFifo.watermark() * imuFifo.samplePeriodUs()) / 1000);
+        TIME_RESTART_INTERVAL();
+        detectorConfigPending = true;
+        xTaskNotifyGive(detectionTaskHandle);
+      }
+      continue;
+    }
+    size_t count;
+    {
+      TIME_STAGE(STAGE_SENSOR_READ);
+#if GYRO_TURN_MODE
+      count = imuFifo.drain(samples, gyroSamples, Lsm9ds1Fifo::FIFO_SLOTS);
+#else
+      count = imuFifo.drain(samples, Lsm9ds1Fifo::FIFO_SLOTS);
+#endif
+    }
+    // Cada ráfaga debería llegar count periodos de muestra después de la anterior
+    if (count > 0) {
+      TIME_SAMPLE_INTERVAL(count * imuFifo.samplePeriodUs());
+    }
+#if GYRO_TURN_MODE
+    for (size_t i = 0; i < count; i++) {
+      if (sampleRing.push(samples[i])) gyroRing.push(gyroSamples[i]);
+    }
+#else
+    // Si la cola está llena la muestra se descarta y queda contada en sampleRing.overflows()
+    for (size_t i = 0; i < count; i++) {
+      sampleRing.push(samples[i]);
+    }
+#endif
+    if (count > 0) {
+      xTaskNotifyGive(detectionTaskHandle);
+    }
+
+    if (rawStreamEnabled && count > 0) {
+      for (size_t i = 0; i < count; i++) {
+        streamRing.push(samples[i]);
+      }
+      xTaskNotifyGive(streamTaskHandle);
+    }
+  }
+}
+
+// Núcleo 0: detección de pasos, sin afectar al ritmo de muestreo ni esperar al BLE
+void detectionTask(void *param) {
+  RawSample block[StepDetector::BLOCK_SIZE];
+#if GYRO_TURN_MODE
+  RawGyroSample gyroBlock[StepDetector::BLOCK_SIZE];
+#endif
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    // La cola se vacía por bloques para que el detector use sus núcleos de bloque
+    size_t count;
+    do {
+      count = 0;
+#if GYRO_TURN_MODE
+      // El giroscopio entra después de su muestra: si está, la muestra también
+      while (count < StepDetector::BLOCK_SIZE && gyroRing.pop(gyroBlock[count])) {
+        sampleRing.pop(block[count]);
+        count++;
+      }
+#else
+      while (count < StepDetector::BLOCK_SIZE && sampleRing.pop(block[count])) count++;
+#endif
+      // La última pasada suele encontrar la cola vacía: no se mide como un bloque
+      if (count == 0) break;
+      sessionRecorder.appendSamples(block, count);
+      TIME_STAGE(STAGE_DETECTION);
+      // La señal se calcula aquí una vez para el historial y para el detector; el
+      // historial va primero para que onStepDetected encuentre ya la muestra del paso
+      uint32_t signal[StepDetector::BLOCK_SIZE];
+#if VERTICAL_ACCEL_MODE
+      for (size_t i = 0; i < count; i++) {
+#if GYRO_TURN_MODE
+        signal[i] = gravityEstimator.verticalSq(block[i], &gyroBlock[i]);
+#else
+        signal[i] = gravityEstimator.verticalSq(block[i], NULL);
+#endif
+      }
+#else
+      blockMagnitudeSquared(block, signal, count);
+#endif
+      historyBuffer.append(block, signal, count);
+      stepDetector.pushSquaredBlock(block, signal, count, onStepDetected);
+#if GYRO_TURN_MODE
+      for (size_t i = 0; i < count; i++) {
+        if (turnDetector.push(block[i], gyroBlock[i])) onTurnDetected(block[i]);
+      }
+#endif
+    } while (count == StepDetector::BLOCK_SIZE);
+    // Con la cola vacía ya no quedan muestras al ritmo anterior
+    if (detectorConfigPending) {
+      detectorConfigPending = false;
+      applyDetectorConfig(1000000.0 / imuFifo.samplePeriodUs());
+      historyBuffer.clear(); // Otro ODR o rango: las cuentas anteriores no se mezclan
+      publishSensorConfig();
+      sessionRecorder.appendSensorConfig(sensorConfig);
+    }
+    serviceDeviceConfig();
+    serviceRecording(millis());
+    updateCadence(millis());
+    updateLinkPolicy(millis());
+  }
+}
+
+// Núcleo 0: empaqueta las muestras crudas según el MTU y las notifica, una vez por ráfaga
+void streamTask(void *param) {
+  RawStreamPacker packer;
+  uint32_t reportedOverflows = 0;
+  RawSample sample;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (!rawStreamEnabled || !deviceConnected) {
+      while (streamRing.pop(sample)) {} // Descartar lo que quedase de una sesión anterior
+      continue;
+    }
+
+    packer.setMaxSize(peerMtu - 3);
+    while (streamRing.pop(sample)) {
+      if (packer.count() == 0) {
+        // Muestras descartadas por la cola desde el paquete anterior (saturado a 16 bits)
+        uint32_t overflows = streamRing.overflows();
+        packer.start((uint16_t)min<uint32_t>(overflows - reportedOverflows, 0xFFFF));
+        reportedOverflows = overflows;
+      }
+      if (!packer.append(sample)) {
+        pRawStreamCharacteristic->setValue((uint8_t*)packer.data(), packer.size());
+        pRawStreamCharacteristic->notify();
+        packer.start(0);
+        packer.append(sample);
+      }
+    }
+
+    if (packer.count() > 0) {
+      pRawStreamCharacteristic->setValue((uint8_t*)packer.data(), packer.size());
+      pRawStreamCharacteristic->notify();
+      packer.start(0);
+    }
+  }
+}
+
+void loop() {
+  // Todo el trabajo lo hacen las tareas fijadas a cada núcleo: se libera la tarea del loop()
+  vTaskDelete(NULL);
+}
+#else
+void loop() {
+  // El ritmo lo marca delay(20), así que solo el rango cambia las constantes del detector
+  serviceDeviceConfig();
+  if (sensorConfigRequested) {
+    sensorConfigRequested = false;
+    if (applySensorConfig(requestedSensorConfig)) {
+      applyDetectorConfig(DETECTION_RATE_HZ);
+      historyBuffer.clear();
+      TIME_RESTART_INTERVAL();
+      publishSensorConfig();
+      sessionRecorder.appendSensorConfig(sensorConfig);
+    }
+  }
+  serviceRecording(millis());
+
+  // Solo los registros del acelerómetro: ni magnetómetro, ni giroscopio, ni temperatura
+  RawSample sample;
+  bool sampled;
+  {
+    TIME_STAGE(STAGE_SENSOR_READ);
+    sampled = imuFifo.readAccel(sample);
+  }
+  if (sampled) {
+    // Lo que se separa el periodo real del nominal de delay(20)
+    TIME_SAMPLE_INTERVAL((uint32_t)(1000000.0 / DETECTION_RATE_HZ));
+    sessionRecorder.appendSamples(&sample, 1);
+    TIME_STAGE(STAGE_DETECTION);
+#if VERTICAL_ACCEL_MODE
+    uint32_t signal = gravityEstimator.verticalSq(sample, NULL);
+#else
+    uint32_t signal = magnitudeSquared(sample);
+#endif
+    historyBuffer.append(&sample, &signal, 1);
+    if (stepDetector.push(signal, sample.t_ms)) {
+      onStepDetected(sample);
     }
   }
+  updateCadence(millis());
+  updateLinkPolicy(millis());
   
   delay(20);
 }
+#endif
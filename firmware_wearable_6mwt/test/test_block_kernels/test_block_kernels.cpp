@@ -0,0 +1,80 @@
+#include <unity.h>
+
+#include <BlockKernels.h>
+
+// Pruebas de los núcleos de bloque. En el entorno nativo se compilan las versiones
+// escalares, que son la referencia de las vectoriales del ESP32-S3
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_block_magnitude_matches_per_sample(void) {
+  RawSample samples[40];
+  for (int i = 0; i < 40; i++) {
+    samples[i] = RawSample{(uint32_t)i, (int16_t)(i * 811 - 16000), (int16_t)(-i * 97), (int16_t)(16384 + i)};
+  }
+  samples[0] = RawSample{0, -32768, -32768, -32768};
+
+  uint32_t out[40];
+  blockMagnitudeSquared(samples, out, 40);
+  for (int i = 0; i < 40; i++) {
+    uint32_t exact = magnitudeSquared(samples[i]);
+    if (BLOCK_MAGNITUDE_SIMD_SHIFT == 0) {
+      TEST_ASSERT_EQUAL_UINT32(exact, out[i]);
+    } else {
+      // El núcleo vectorial trunca cada eje: nunca por encima, y como mucho 3 * 2^shift por debajo
+      TEST_ASSERT_LESS_OR_EQUAL_UINT32(exact, out[i]);
+      TEST_ASSERT_LESS_THAN_UINT32(3u << BLOCK_MAGNITUDE_SIMD_SHIFT, exact - out[i]);
+    }
+  }
+}
+
+void test_dot_and_sums_match_reference(void) {
+  float a[67];
+  float b[67];
+  double dot = 0, sum = 0, sumSq = 0;
+  for (int i = 0; i < 67; i++) {
+    a[i] = 0.25F * (i % 9) - 1.0F;
+    b[i] = 0.5F * (i % 5);
+    dot += (double)a[i] * b[i];
+    sum += a[i];
+    sumSq += (double)a[i] * a[i];
+  }
+
+  // 67 no es múltiplo de 4: también cubre la cola del bucle desenrollado
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, dot, blockDot(a, b, 67));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, dot, blockDotScalar(a, b, 67));
+  float s, sq;
+  blockSums(a, 67, s, sq);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, sum, s);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, sumSq, sq);
+}
+
+void test_moving_stats_forget_old_blocks(void) {
+  BlockMovingStats<2> stats;
+  float ones[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+  float alternating[8] = {2, 4, 2, 4, 2, 4, 2, 4};
+
+  stats.push(ones, 8);
+  TEST_ASSERT_EQUAL_UINT32(8, stats.samples());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0F, stats.mean());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0F, stats.variance());
+
+  // Tras dos bloques más el de unos ya ha salido de la ventana
+  stats.push(alternating, 8);
+  stats.push(alternating, 8);
+  TEST_ASSERT_EQUAL_UINT32(16, stats.samples());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 3.0F, stats.mean());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0F, stats.variance());
+
+  stats.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, stats.samples());
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_block_magnitude_matches_per_sample);
+  RUN_TEST(test_dot_and_sums_match_reference);
+  RUN_TEST(test_moving_stats_forget_old_blocks);
+  return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#include <unity.h>
+
+#include <string.h>
+#include <vector>
+#include <ByteOrder.h>
+#include <FileTransferServer.h>
+
+// Pruebas del servidor de descarga de sesiones con un almacén en memoria y un enlace
+// que guarda lo que se le envía
+
+struct MemoryFile {
+  uint16_t id;
+  std::vector<uint8_t> bytes;
+};
+
+class MemoryStore : public FileTransferStore {
+  public:
+    std::vector<MemoryFile> files;
+    int openFile = -1;
+    bool failReads = false;
+
+    size_t refresh() override { return files.size(); }
+    bool info(size_t index, FileInfo &out) override {
+      if (index >= files.size()) return false;
+      out = FileInfo{files[index].id, (uint32_t)files[index].bytes.size(), 0};
+      return true;
+    }
+    bool open(uint16_t id, uint32_t &size) override {
+      for (size_t i = 0; i < files.size(); i++) {
+        if (files[i].id == id) {
+          openFile = (int)i;
+          size = (uint32_t)files[i].bytes.size();
+          return true;
+        }
+      }
+      return false;
+    }
+    size_t read(uint32_t offset, uint8_t *out, size_t len) override {
+      if (openFile < 0 || failReads) return 0;
+      const std::vector<uint8_t> &bytes = files[openFile].bytes;
+      if (offset >= bytes.size()) return 0;
+      if (len > bytes.size() - offset) len = bytes.size() - offset;
+      memcpy(out, &bytes[offset], len);
+      return len;
+    }
+    void close() override { openFile = -1; }
+};
+
+class RecordingLink : public FileTransferLink {
+  public:
+    size_t mtuPayload = 20;
+    bool busy = false;
+    std::vector<std::vector<uint8_t>> control;
+    std::vector<std::vector<uint8_t>> data;
+
+    size_t maxPacket() override { return mtuPayload; }
+    bool sendControl(const uint8_t *bytes, size_t len) override {
+      control.push_back(std::vector<uint8_t>(bytes, bytes + len));
+      return true;
+    }
+    bool sendData(const uint8_t *bytes, size_t len) override {
+      if (busy) return false;
+      data.push_back(std::vector<uint8_t>(bytes, bytes + len));
+      return true;
+    }
+};
+
+static MemoryStore store;
+static RecordingLink client;
+
+static std::vector<uint8_t> pattern(size_t size, uint8_t seed) {
+  std::vector<uint8_t> bytes(size);
+  for (size_t i = 0; i < size; i++) bytes[i] = (uint8_t)(i * 31 + seed);
+  return bytes;
+}
+
+static void requestRead(FileTransferServer &server, uint16_t id, uint32_t from, uint32_t length, uint16_t credits) {
+  uint8_t r[13];
+  r[0] = FT_OP_READ;
+  putLe16(r + 1, id);
+  putLe32(r + 3, from);
+  putLe32(r + 7, length);
+  putLe16(r + 11, credits);
+  TEST_ASSERT_TRUE(server.enqueue(r, sizeof(r)));
+}
+
+static void requestCredit(FileTransferServer &server, uint16_t credits) {
+  uint8_t r[3] = {FT_OP_CREDIT, 0, 0};
+  putLe16(r + 1, credits);
+  TEST_ASSERT_TRUE(server.enqueue(r, sizeof(r)));
+}
+
+// Reconstruye los datos recibidos comprobando offset contiguo y CRC de cada fragmento
+static std::vector<uint8_t> reassemble(uint32_t from) {
+  std::vector<uint8_t> out;
+  uint32_t expected = from;
+  for (size_t i = 0; i < client.data.size(); i++) {
+    const std::vector<uint8_t> &chunk = client.data[i];
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(FT_CHUNK_HEADER_SIZE, chunk.size());
+    TEST_ASSERT_EQUAL_UINT32(expected, getLe32(&chunk[0]));
+    uint16_t crc = crc16Update(crc16(&chunk[0], 4), &chunk[FT_CHUNK_HEADER_SIZE], chunk.size() - FT_CHUNK_HEADER_SIZE);
+    TEST_ASSERT_EQUAL_UINT16(crc, getLe16(&chunk[4]));
+    out.insert(out.end(), chunk.begin() + FT_CHUNK_HEADER_SIZE, chunk.end());
+    expected += (uint32_t)(chunk.size() - FT_CHUNK_HEADER_SIZE);
+  }
+  return out;
+}
+
+void setUp(void) {
+  store = MemoryStore();
+  store.files.push_back(MemoryFile{3, pattern(1000, 1)});
+  store.files.push_back(MemoryFile{4, pattern(37, 2)});
+  store.files.push_back(MemoryFile{9, pattern(0, 3)});
+  client = RecordingLink();
+}
+
+void tearDown(void) {}
+
+void test_crc16_ccitt_false_check_value(void) {
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  TEST_ASSERT_EQUAL_UINT16(0x29B1, crc16(check, sizeof(check)));
+}
+
+void test_list_pages_fit_the_mtu(void) {
+  FileTransferServer server(store, client);
+  // MTU por defecto: cabecera de 7 bytes y una sola entrada de 7 por notificación
+  uint8_t r[3] = {FT_OP_LIST, 0, 0};
+  server.enqueue(r, sizeof(r));
+  server.service(0);
+  putLe16(r + 1, 1);
+  server.enqueue(r, sizeof(r));
+  server.service(0);
+
+  TEST_ASSERT_EQUAL_size_t(2, client.control.size());
+  const std::vector<uint8_t> &page = client.control[1];
+  TEST_ASSERT_EQUAL_HEX8(FT_OP_LIST | FT_RESPONSE, page[0]);
+  TEST_ASSERT_EQUAL_UINT8(FT_OK, page[1]);
+  TEST_ASSERT_EQUAL_UINT16(1, getLe16(&page[2]));
+  TEST_ASSERT_EQUAL_UINT16(3, getLe16(&page[4]));
+  TEST_ASSERT_EQUAL_UINT8(1, page[6]);
+  TEST_ASSERT_EQUAL_UINT16(4, getLe16(&page[7]));
+  TEST_ASSERT_EQUAL_UINT32(37, getLe32(&page[9]));
+}
+
+void test_read_whole_file_with_credits(void) {
+  FileTransferServer server(store, client);
+  client.mtuPayload = 100;
+  requestRead(server, 3, 0, 0, 4);
+  server.service(100);
+
+  // Respuesta al READ: rango y bytes por fragmento
+  const std::vector<uint8_t> &response = client.control[0];
+  TEST_ASSERT_EQUAL_HEX8(FT_OP_READ | FT_RESPONSE, response[0]);
+  TEST_ASSERT_EQUAL_UINT8(FT_OK, response[1]);
+  TEST_ASSERT_EQUAL_UINT32(1000, getLe32(&response[8]));
+  TEST_ASSERT_EQUAL_UINT16(100 - FT_CHUNK_HEADER_SIZE, getLe16(&response[12]));
+
+  // Se detiene al agotar los créditos y sigue al recibir más
+  TEST_ASSERT_EQUAL_size_t(4, client.data.size());
+  TEST_ASSERT_TRUE(server.reading());
+  for (int i = 0; i < 20 && server.reading(); i++) {
+    requestCredit(server, 2);
+    server.service(100);
+  }
+
+  TEST_ASSERT_FALSE(server.reading());
+  TEST_ASSERT_TRUE(reassemble(0) == store.files[0].bytes);
+  const std::vector<uint8_t> &done = client.control.back();
+  TEST_ASSERT_EQUAL_HEX8(FT_OP_DONE | FT_RESPONSE, done[0]);
+  TEST_ASSERT_EQUAL_UINT16(3, getLe16(&done[2]));
+  TEST_ASSERT_EQUAL_UINT32(1000, getLe32(&done[4]));
+  TEST_ASSERT_EQUAL_INT(-1, store.openFile);
+}
+
+void test_busy_link_retries_the_same_chunk(void) {
+  FileTransferServer server(store, client);
+  requestRead(server, 4, 0, 0, 100);
+  client.busy = true;
+  TEST_ASSERT_TRUE(server.service(10));
+  TEST_ASSERT_EQUAL_size_t(0, client.data.size());
+
+  client.busy = false;
+  while (server.service(10)) {}
+  TEST_ASSERT_TRUE(reassemble(0) == store.files[1].bytes);
+}
+
+void test_resume_from_offset_with_length(void) {
+  FileTransferServer server(store, client);
+  client.mtuPayload = 64;
+  requestRead(server, 3, 500, 200, 100);
+  while (server.service(10)) {}
+
+  std::vector<uint8_t> expected(store.files[0].bytes.begin() + 500, store.files[0].bytes.begin() + 700);
+  TEST_ASSERT_TRUE(reassemble(500) == expected);
+  TEST_ASSERT_EQUAL_UINT32(700, getLe32(&client.control.back()[4]));
+}
+
+void test_empty_file_finishes_immediately(void) {
+  FileTransferServer server(store, client);
+  requestRead(server, 9, 0, 0, 1);
+  server.service(10);
+  TEST_ASSERT_EQUAL_size_t(0, client.data.size());
+  TEST_ASSERT_EQUAL_HEX8(FT_OP_DONE | FT_RESPONSE, client.control.back()[0]);
+  TEST_ASSERT_FALSE(server.reading());
+}
+
+void test_errors_are_reported(void) {
+  FileTransferServer server(store, client);
+  requestRead(server, 77, 0, 0, 1);
+  requestRead(server, 4, 30, 10, 1);
+  uint8_t unknown[1] = {0x42};
+  server.enqueue(unknown, 1);
+  uint8_t shortRead[3] = {FT_OP_READ, 3, 0};
+  server.enqueue(shortRead, sizeof(shortRead));
+  server.service(10);
+
+  TEST_ASSERT_EQUAL_size_t(4, client.control.size());
+  TEST_ASSERT_EQUAL_UINT8(FT_NOT_FOUND, client.control[0][1]);
+  TEST_ASSERT_EQUAL_UINT8(FT_BAD_RANGE, client.control[1][1]);
+  TEST_ASSERT_EQUAL_HEX8(0x42 | FT_RESPONSE, client.control[2][0]);
+  TEST_ASSERT_EQUAL_UINT8(FT_BAD_REQUEST, client.control[2][1]);
+  TEST_ASSERT_EQUAL_UINT8(FT_BAD_REQUEST, client.control[3][1]);
+  TEST_ASSERT_FALSE(server.reading());
+
+  // Fallo de lectura de la flash a mitad de descarga
+  requestRead(server, 3, 0, 0, 10);
+  store.failReads = true;
+  server.service(10);
+  TEST_ASSERT_EQUAL_UINT8(FT_IO_ERROR, client.control.back()[1]);
+  TEST_ASSERT_FALSE(server.reading());
+}
+
+void test_abort_stops_reading(void) {
+  FileTransferServer server(store, client);
+  requestRead(server, 3, 0, 0, 2);
+  server.service(10);
+  uint8_t abortRequest[1] = {FT_OP_ABORT};
+  server.enqueue(abortRequest, 1);
+  requestCredit(server, 10);
+  server.service(10);
+
+  TEST_ASSERT_FALSE(server.reading());
+  TEST_ASSERT_EQUAL_size_t(2, client.data.size());
+  TEST_ASSERT_EQUAL_INT(-1, store.openFile);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc16_ccitt_false_check_value);
+  RUN_TEST(test_list_pages_fit_the_mtu);
+  RUN_TEST(test_read_whole_file_with_credits);
+  RUN_TEST(test_busy_link_retries_the_same_chunk);
+  RUN_TEST(test_resume_from_offset_with_length);
+  RUN_TEST(test_empty_file_finishes_immediately);
+  RUN_TEST(test_errors_are_reported);
+  RUN_TEST(test_abort_stops_reading);
+  return UNITY_END();
+}
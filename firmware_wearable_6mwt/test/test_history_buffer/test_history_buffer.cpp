@@ -0,0 +1,162 @@
+#include <unity.h>
+
+#include <atomic>
+#include <thread>
+#include <ByteOrder.h>
+#include <HistoryBuffer.h>
+
+// Pruebas del historial circular: vuelta del anillo, lecturas que cruzan el final,
+// búsqueda por instante y un lector concurrente con el escritor
+
+static const size_t CAPACITY = 100;
+static HistoryEntry storage[CAPACITY];
+static HistoryBuffer history;
+
+// Añade las muestras [first, first + n) con t_ms = 10 * i y la señal derivada de i
+static void appendRange(uint32_t first, size_t n) {
+  RawSample samples[64];
+  uint32_t signal[64];
+  while (n > 0) {
+    size_t chunk = n < 64 ? n : 64;
+    for (size_t i = 0; i < chunk; i++) {
+      uint32_t index = first + (uint32_t)i;
+      samples[i] = RawSample{index * 10, (int16_t)index, (int16_t)(index >> 16), (int16_t)~index};
+      signal[i] = index * 7 + 1;
+    }
+    history.append(samples, signal, chunk);
+    first += (uint32_t)chunk;
+    n -= chunk;
+  }
+}
+
+static bool consistent(const HistoryEntry &e, uint32_t index) {
+  return e.t_ms == index * 10 && e.x == (int16_t)index && e.y == (int16_t)(index >> 16) &&
+         e.z == (int16_t)~index && e.signalSq == index * 7 + 1;
+}
+
+void setUp(void) {
+  history.attach(storage, CAPACITY, false);
+}
+
+void tearDown(void) {}
+
+void test_detached_buffer_is_inert(void) {
+  HistoryBuffer empty;
+  empty.attach(NULL, CAPACITY, false);
+  RawSample sample{0, 1, 2, 3};
+  uint32_t signal = 1;
+  empty.append(&sample, &signal, 1);
+  HistoryEntry out;
+  TEST_ASSERT_FALSE(empty.attached());
+  TEST_ASSERT_EQUAL_UINT32(0, empty.end());
+  TEST_ASSERT_EQUAL_size_t(0, empty.read(0, &out, 1));
+}
+
+void test_append_and_read_before_wrap(void) {
+  appendRange(0, 40);
+  TEST_ASSERT_EQUAL_UINT32(0, history.begin());
+  TEST_ASSERT_EQUAL_UINT32(40, history.end());
+
+  HistoryEntry out[50];
+  TEST_ASSERT_EQUAL_size_t(30, history.read(10, out, 50));
+  for (uint32_t i = 0; i < 30; i++) TEST_ASSERT_TRUE(consistent(out[i], 10 + i));
+  TEST_ASSERT_EQUAL_size_t(0, history.read(40, out, 1));
+}
+
+void test_read_across_the_end_of_the_ring(void) {
+  appendRange(0, 250);
+  TEST_ASSERT_EQUAL_UINT32(150, history.begin());
+
+  // 190 % 100 = 90: de 190 a 229 la copia da la vuelta en la posición 0
+  HistoryEntry out[40];
+  TEST_ASSERT_EQUAL_size_t(40, history.read(190, out, 40));
+  for (uint32_t i = 0; i < 40; i++) TEST_ASSERT_TRUE(consistent(out[i], 190 + i));
+}
+
+void test_overwritten_and_in_flight_entries_are_refused(void) {
+  appendRange(0, 250);
+  HistoryEntry out[4];
+  TEST_ASSERT_EQUAL_size_t(0, history.read(100, out, 4));
+  // Las BLOCK más antiguas son las que el escritor sobrescribe en su próximo bloque
+  TEST_ASSERT_EQUAL_size_t(0, history.read(history.begin(), out, 4));
+  TEST_ASSERT_EQUAL_size_t(0, history.read(history.begin() + HistoryBuffer::BLOCK - 1, out, 1));
+  TEST_ASSERT_EQUAL_size_t(1, history.read(history.begin() + HistoryBuffer::BLOCK, out, 1));
+}
+
+void test_index_at_time(void) {
+  appendRange(0, 250);
+  TEST_ASSERT_EQUAL_UINT32(200, history.indexAtTime(2000));
+  TEST_ASSERT_EQUAL_UINT32(201, history.indexAtTime(2001));
+  // Antes de lo guardado: la más antigua; después: end()
+  TEST_ASSERT_EQUAL_UINT32(history.begin(), history.indexAtTime(0));
+  TEST_ASSERT_EQUAL_UINT32(history.end(), history.indexAtTime(100000));
+}
+
+void test_mark_step_flags_recent_entry(void) {
+  appendRange(0, 60);
+  history.markStep(550);
+  // Fuera de las últimas BLOCK entradas no se busca
+  history.markStep(100);
+
+  HistoryEntry out[60];
+  TEST_ASSERT_EQUAL_size_t(60, history.read(0, out, 60));
+  for (uint32_t i = 0; i < 60; i++) {
+    TEST_ASSERT_EQUAL_UINT8(i == 55 ? HISTORY_STEP : 0, out[i].flags);
+  }
+}
+
+void test_diagnostics_section(void) {
+  appendRange(0, 130);
+  uint8_t buffer[32];
+  TlvWriter writer(buffer, sizeof(buffer));
+  history.writeDiagnostics(writer);
+
+  TEST_ASSERT_EQUAL_size_t(1 + 2 + 13, writer.size());
+  TEST_ASSERT_EQUAL_UINT8(DIAG_TAG_HISTORY, buffer[1]);
+  TEST_ASSERT_EQUAL_UINT8(13, buffer[2]);
+  TEST_ASSERT_EQUAL_UINT32(CAPACITY, getLe32(&buffer[3]));
+  TEST_ASSERT_EQUAL_UINT32(CAPACITY, getLe32(&buffer[7]));
+  TEST_ASSERT_EQUAL_UINT32(300, getLe32(&buffer[11]));
+  TEST_ASSERT_EQUAL_UINT8(0, buffer[15]);
+}
+
+void test_concurrent_reader_never_accepts_torn_copies(void) {
+  const uint32_t TOTAL = 2000000;
+  std::atomic<bool> done{false};
+
+  std::thread writer([&]() {
+    for (uint32_t i = 0; i < TOTAL; i += 64) appendRange(i, 64);
+    done.store(true);
+  });
+
+  // El lector persigue lo más antiguo, donde escribe el escritor al dar la vuelta, con
+  // un desfase que recorre el bloque en vuelo y algo más
+  uint32_t accepted = 0;
+  uint32_t torn = 0;
+  HistoryEntry out[8];
+  for (uint32_t k = 0; !done.load(); k++) {
+    uint32_t from = history.begin() + k % (HistoryBuffer::BLOCK + 16);
+    size_t got = history.read(from, out, 8);
+    for (size_t i = 0; i < got; i++) {
+      if (!consistent(out[i], from + (uint32_t)i)) torn++;
+    }
+    if (got > 0) accepted++;
+  }
+  writer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, accepted);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_detached_buffer_is_inert);
+  RUN_TEST(test_append_and_read_before_wrap);
+  RUN_TEST(test_read_across_the_end_of_the_ring);
+  RUN_TEST(test_overwritten_and_in_flight_entries_are_refused);
+  RUN_TEST(test_index_at_time);
+  RUN_TEST(test_mark_step_flags_recent_entry);
+  RUN_TEST(test_diagnostics_section);
+  RUN_TEST(test_concurrent_reader_never_accepts_torn_copies);
+  return UNITY_END();
+}
@@ -0,0 +1,88 @@
+#include <unity.h>
+
+#include <ByteOrder.h>
+#include <RawStreamPacket.h>
+
+// Pruebas del formato de la característica de streaming de muestras crudas
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_header_and_samples_layout(void) {
+  RawStreamPacker packer;
+  packer.setMaxSize(RawStreamPacker::MAX_PACKET_SIZE);
+  packer.start(7);
+  TEST_ASSERT_TRUE(packer.append(RawSample{1000, 1, -2, 16384}));
+  TEST_ASSERT_TRUE(packer.append(RawSample{1008, -32768, 32767, 0}));
+
+  const uint8_t *p = packer.data();
+  TEST_ASSERT_EQUAL_size_t(RawStreamPacker::HEADER_SIZE + 2 * RawStreamPacker::SAMPLE_SIZE, packer.size());
+  TEST_ASSERT_EQUAL_UINT8(RawStreamPacker::VERSION, p[0]);
+  TEST_ASSERT_EQUAL_UINT8(2, p[1]);
+  TEST_ASSERT_EQUAL_UINT16(0, getLe16(&p[2]));
+  TEST_ASSERT_EQUAL_UINT32(1000, getLe32(&p[4]));
+  TEST_ASSERT_EQUAL_UINT16(7, getLe16(&p[8]));
+
+  const uint8_t *s = p + RawStreamPacker::HEADER_SIZE;
+  TEST_ASSERT_EQUAL_UINT16(0, getLe16(s));
+  TEST_ASSERT_EQUAL_INT16(1, (int16_t)getLe16(s + 2));
+  TEST_ASSERT_EQUAL_INT16(-2, (int16_t)getLe16(s + 4));
+  TEST_ASSERT_EQUAL_INT16(16384, (int16_t)getLe16(s + 6));
+  s += RawStreamPacker::SAMPLE_SIZE;
+  TEST_ASSERT_EQUAL_UINT16(8, getLe16(s));
+  TEST_ASSERT_EQUAL_INT16(-32768, (int16_t)getLe16(s + 2));
+  TEST_ASSERT_EQUAL_INT16(32767, (int16_t)getLe16(s + 4));
+}
+
+void test_packet_fills_to_max_size(void) {
+  RawStreamPacker packer;
+  // MTU por defecto (23): solo cabe una muestra
+  packer.setMaxSize(20);
+  packer.start(0);
+  TEST_ASSERT_TRUE(packer.append(RawSample{0, 0, 0, 0}));
+  TEST_ASSERT_FALSE(packer.append(RawSample{8, 0, 0, 0}));
+  TEST_ASSERT_EQUAL_UINT8(1, packer.count());
+
+  packer.setMaxSize(RawStreamPacker::MAX_PACKET_SIZE);
+  packer.start(0);
+  size_t fit = (RawStreamPacker::MAX_PACKET_SIZE - RawStreamPacker::HEADER_SIZE) / RawStreamPacker::SAMPLE_SIZE;
+  for (size_t i = 0; i < fit; i++) TEST_ASSERT_TRUE(packer.append(RawSample{(uint32_t)i * 8, 0, 0, 0}));
+  TEST_ASSERT_FALSE(packer.append(RawSample{(uint32_t)fit * 8, 0, 0, 0}));
+  TEST_ASSERT_EQUAL_UINT8(fit, packer.count());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(RawStreamPacker::MAX_PACKET_SIZE, packer.size());
+}
+
+void test_time_offset_must_fit_16_bits(void) {
+  RawStreamPacker packer;
+  packer.setMaxSize(RawStreamPacker::MAX_PACKET_SIZE);
+  packer.start(0);
+  TEST_ASSERT_TRUE(packer.append(RawSample{100, 0, 0, 0}));
+  TEST_ASSERT_TRUE(packer.append(RawSample{100 + 0xFFFF, 0, 0, 0}));
+  // Tras un hueco largo la muestra va en el paquete siguiente, con su propio t0
+  TEST_ASSERT_FALSE(packer.append(RawSample{100 + 0x10000, 0, 0, 0}));
+  packer.start(0);
+  TEST_ASSERT_TRUE(packer.append(RawSample{100 + 0x10000, 0, 0, 0}));
+  TEST_ASSERT_EQUAL_UINT32(100 + 0x10000, getLe32(&packer.data()[4]));
+}
+
+void test_sequence_advances_only_after_non_empty_packet(void) {
+  RawStreamPacker packer;
+  packer.setMaxSize(RawStreamPacker::MAX_PACKET_SIZE);
+  packer.start(0);
+  packer.start(0);
+  TEST_ASSERT_EQUAL_UINT16(0, packer.sequence());
+
+  packer.append(RawSample{0, 0, 0, 0});
+  packer.start(0);
+  TEST_ASSERT_EQUAL_UINT16(1, packer.sequence());
+  TEST_ASSERT_EQUAL_UINT16(1, getLe16(&packer.data()[2]));
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_header_and_samples_layout);
+  RUN_TEST(test_packet_fills_to_max_size);
+  RUN_TEST(test_time_offset_must_fit_16_bits);
+  RUN_TEST(test_sequence_advances_only_after_non_empty_packet);
+  return UNITY_END();
+}
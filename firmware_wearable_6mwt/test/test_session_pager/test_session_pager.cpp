@@ -0,0 +1,133 @@
+#include <unity.h>
+
+#include <ByteOrder.h>
+#include <SessionPager.h>
+
+// Pruebas de la doble página de la grabación: registros SAMPLES que crecen entre
+// ráfagas y el peor caso de tamaño de una sesión
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Consumidor inmediato: escribe cada página cerrada en cuanto se entrega
+struct PageCounter {
+  uint32_t pages = 0;
+  uint32_t samples = 0;
+  uint32_t records = 0;
+
+  void drain(SessionPager &pager) {
+    uint8_t index = pager.takeSealed();
+    if (index == SessionPager::NO_PAGE) return;
+    const uint8_t *p = pager.page(index);
+    for (size_t at = 0; at < SESSION_PAGE_SIZE && p[at] != SESSION_REC_PAD;) {
+      records++;
+      switch (p[at]) {
+        case SESSION_REC_HEADER: at += SESSION_HEADER_SIZE; break;
+        case SESSION_REC_SAMPLES: samples += p[at + 1]; at += sessionSamplesSize(p[at + 1]); break;
+        case SESSION_REC_STEP: at += SESSION_STEP_SIZE; break;
+        case SESSION_REC_END: at += SESSION_END_SIZE; break;
+        default: TEST_FAIL_MESSAGE("registro desconocido"); return;
+      }
+    }
+    pages++;
+    pager.release(index);
+  }
+};
+
+static RawSample sampleAt(uint32_t i) {
+  return RawSample{i * 4, (int16_t)i, (int16_t)-i, 16384};
+}
+
+void test_samples_grow_one_record_across_batches(void) {
+  SessionPager pager;
+  for (uint32_t i = 0; i < 10; i++) {
+    RawSample s = sampleAt(i);
+    pager.appendSamples(&s, 1);
+  }
+  pager.seal();
+
+  const uint8_t *p = pager.page(pager.takeSealed());
+  TEST_ASSERT_EQUAL_UINT8(SESSION_REC_SAMPLES, p[0]);
+  TEST_ASSERT_EQUAL_UINT8(10, p[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, getLe32(p + 2));
+  // Cada muestra guarda su distancia a la anterior, también entre ráfagas
+  const uint8_t *last = p + SESSION_SAMPLES_HEADER_SIZE + 9 * SESSION_SAMPLE_SIZE;
+  TEST_ASSERT_EQUAL_UINT8(4, last[0]);
+  TEST_ASSERT_EQUAL_UINT16(9, getLe16(last + 1));
+  TEST_ASSERT_EQUAL_UINT8(SESSION_REC_PAD, p[sessionSamplesSize(10)]);
+}
+
+void test_other_record_closes_samples(void) {
+  SessionPager pager;
+  RawSample s[2] = {sampleAt(0), sampleAt(1)};
+  pager.appendSamples(&s[0], 1);
+  uint8_t *step = pager.reserve(SESSION_STEP_SIZE);
+  pager.commit(packSessionStep(step, StepEvent{0, 1, 0, 0, 0, 0}));
+  pager.appendSamples(&s[1], 1);
+  pager.seal();
+
+  const uint8_t *p = pager.page(pager.takeSealed());
+  TEST_ASSERT_EQUAL_UINT8(1, p[1]);
+  const uint8_t *second = p + sessionSamplesSize(1) + SESSION_STEP_SIZE;
+  TEST_ASSERT_EQUAL_UINT8(SESSION_REC_SAMPLES, second[0]);
+  TEST_ASSERT_EQUAL_UINT8(1, second[1]);
+  TEST_ASSERT_EQUAL_UINT32(4, getLe32(second + 2));
+}
+
+void test_record_stops_at_max_samples(void) {
+  SessionPager pager;
+  static RawSample s[300];
+  for (uint32_t i = 0; i < 300; i++) s[i] = sampleAt(i);
+  pager.appendSamples(s, 300);
+  pager.seal();
+
+  const uint8_t *p = pager.page(pager.takeSealed());
+  TEST_ASSERT_EQUAL_UINT8(SESSION_MAX_SAMPLES_PER_RECORD, p[1]);
+  const uint8_t *second = p + sessionSamplesSize(SESSION_MAX_SAMPLES_PER_RECORD);
+  TEST_ASSERT_EQUAL_UINT8(300 - SESSION_MAX_SAMPLES_PER_RECORD, second[1]);
+}
+
+void test_full_session_fits_worst_case(void) {
+  // Diez minutos a 238 Hz con la FIFO vaciada muestra a muestra y 240 pasos/min
+  const uint32_t RATE = 238;
+  const uint32_t DURATION_MS = 10 * 60000;
+  const uint32_t STEPS_PER_MINUTE = 240;
+  SessionPager pager;
+  PageCounter file;
+
+  uint8_t *p = pager.reserve(SESSION_HEADER_SIZE);
+  pager.commit(packSessionHeader(p, 1, 0, SensorConfig{2, 0, 1}));
+  uint32_t total = RATE * DURATION_MS / 1000;
+  uint32_t samplesPerStep = RATE * 60 / STEPS_PER_MINUTE;
+  for (uint32_t i = 0; i < total; i++) {
+    RawSample s = sampleAt(i);
+    pager.appendSamples(&s, 1);
+    file.drain(pager);
+    if (i % samplesPerStep == samplesPerStep - 1) {
+      p = pager.reserve(SESSION_STEP_SIZE);
+      pager.commit(packSessionStep(p, StepEvent{s.t_ms, i / samplesPerStep + 1, 0, 0, 0, 0}));
+      file.drain(pager);
+    }
+  }
+  p = pager.reserve(SESSION_END_SIZE);
+  pager.commit(packSessionEnd(p, 0, 0, 0, 0));
+  file.drain(pager);
+  pager.seal();
+  file.drain(pager);
+
+  TEST_ASSERT_EQUAL_UINT32(0, pager.droppedRecords());
+  TEST_ASSERT_EQUAL_UINT32(total, file.samples);
+  size_t bytes = (size_t)file.pages * SESSION_PAGE_SIZE;
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(sessionWorstCaseBytes(RATE, DURATION_MS, STEPS_PER_MINUTE), bytes);
+  // Sin agrupar entre ráfagas serían ~13 bytes por muestra
+  TEST_ASSERT_LESS_THAN_UINT32(total * 8, bytes);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_samples_grow_one_record_across_batches);
+  RUN_TEST(test_other_record_closes_samples);
+  RUN_TEST(test_record_stops_at_max_samples);
+  RUN_TEST(test_full_session_fits_worst_case);
+  return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+
+#include <thread>
+#include <SpscRing.h>
+
+// Pruebas de la cola SPSC: semántica en un solo hilo y un productor y un consumidor
+// reales en hilos distintos, como la adquisición y la detección en el ESP32
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_push_pop_preserves_order(void) {
+  SpscRing<uint32_t, 8> ring;
+  uint32_t value = 0;
+
+  TEST_ASSERT_TRUE(ring.empty());
+  TEST_ASSERT_FALSE(ring.pop(value));
+  for (uint32_t i = 0; i < 5; i++) TEST_ASSERT_TRUE(ring.push(i));
+  TEST_ASSERT_EQUAL_UINT32(5, ring.size());
+  for (uint32_t i = 0; i < 5; i++) {
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(i, value);
+  }
+  TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_full_ring_counts_overflows(void) {
+  SpscRing<uint32_t, 4> ring;
+  for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_TRUE(ring.push(i));
+  TEST_ASSERT_FALSE(ring.push(99));
+  TEST_ASSERT_FALSE(ring.push(99));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.overflows());
+  TEST_ASSERT_EQUAL_UINT32(4, ring.highWater());
+
+  // Lo descartado no llega al consumidor: lo primero sigue siendo el elemento más antiguo
+  uint32_t value = 0;
+  TEST_ASSERT_TRUE(ring.pop(value));
+  TEST_ASSERT_EQUAL_UINT32(0, value);
+  TEST_ASSERT_TRUE(ring.push(4));
+  TEST_ASSERT_EQUAL_UINT32(4, ring.size());
+}
+
+void test_masking_over_many_laps(void) {
+  // Los índices avanzan libremente; tras muchas vueltas al buffer el enmascarado sigue cuadrando
+  SpscRing<uint16_t, 2> ring;
+  uint16_t value = 0;
+  for (uint32_t i = 0; i < 200000; i++) {
+    TEST_ASSERT_TRUE(ring.push((uint16_t)i));
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT16((uint16_t)i, value);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, ring.overflows());
+}
+
+void test_indices_wrap_around_uint32(void) {
+  // Índices a 5 de UINT32_MAX: llenar la cola cruza la vuelta del contador de head
+  SpscRing<uint32_t, 8> ring(UINT32_MAX - 4);
+  uint32_t value = 0;
+
+  TEST_ASSERT_TRUE(ring.empty());
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(ring.push(i));
+    TEST_ASSERT_EQUAL_UINT32(i + 1, ring.size());
+  }
+  TEST_ASSERT_FALSE(ring.push(99));
+  TEST_ASSERT_EQUAL_UINT32(1, ring.overflows());
+  TEST_ASSERT_EQUAL_UINT32(8, ring.highWater());
+
+  // El consumidor cruza la vuelta después, con head ya en valores pequeños
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(i, value);
+    TEST_ASSERT_EQUAL_UINT32(7 - i, ring.size());
+  }
+  TEST_ASSERT_FALSE(ring.pop(value));
+
+  // Y sigue funcionando pasada la vuelta
+  for (uint32_t i = 0; i < 20; i++) {
+    TEST_ASSERT_TRUE(ring.push(100 + i));
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_UINT32(100 + i, value);
+  }
+  TEST_ASSERT_TRUE(ring.empty());
+  TEST_ASSERT_EQUAL_UINT32(1, ring.overflows());
+}
+
+// Elemento más ancho que un registro: una copia a medio publicar se vería como
+// campos que no cuadran entre sí
+struct Item {
+  uint32_t seq;
+  uint32_t check;
+  uint64_t pad;
+};
+
+void test_two_thread_stress(void) {
+  static SpscRing<Item, 64> ring;
+  const uint32_t ITEMS = 2000000;
+
+  std::thread producer([&]() {
+    for (uint32_t i = 0; i < ITEMS;) {
+      Item item{i, ~i, (uint64_t)i * 3};
+      if (ring.push(item)) {
+        i++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t errors = 0;
+  Item item;
+  while (expected < ITEMS) {
+    if (!ring.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (item.seq != expected || item.check != ~expected || item.pad != (uint64_t)expected * 3) errors++;
+    expected++;
+  }
+  producer.join();
+
+  // Ni pérdidas, ni duplicados, ni desorden, ni copias rotas
+  TEST_ASSERT_EQUAL_UINT32(0, errors);
+  TEST_ASSERT_TRUE(ring.empty());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(64, ring.highWater());
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_pop_preserves_order);
+  RUN_TEST(test_full_ring_counts_overflows);
+  RUN_TEST(test_masking_over_many_laps);
+  RUN_TEST(test_indices_wrap_around_uint32);
+  RUN_TEST(test_two_thread_stress);
+  return UNITY_END();
+}
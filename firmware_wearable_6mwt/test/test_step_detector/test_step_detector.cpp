@@ -0,0 +1,217 @@
+#include <unity.h>
+
+#include <math.h>
+#include <StepDetector.h>
+
+// Pruebas del detector de pasos sobre señales sintéticas en m/s², pasadas a cuentas²
+// del rango ±2g como las recibe push(magnitudeSq, t_ms)
+
+static const uint32_t PERIOD_MS = 10; // 100 Hz
+
+static uint32_t sq(float ms2) {
+  float counts = ms2 / ACCEL_MS2_PER_COUNT_2G;
+  return (uint32_t)(counts * counts);
+}
+
+// Configuración base: umbrales fijos, sin filtro ni filtro de cadencia, para que cada
+// prueba active solo lo que mide
+static StepDetector::Config plainConfig() {
+  StepDetector::Config cfg = StepDetector::defaultConfig(1000.0 / PERIOD_MS);
+  cfg.filterEnabled = false;
+  cfg.adaptive = false;
+  cfg.cadenceGate = false;
+  return cfg;
+}
+
+// Mantiene 'ms2' durante 'durationMs' a partir de *t; devuelve los pasos completados
+static uint32_t hold(StepDetector &detector, float ms2, uint32_t durationMs, uint32_t *t) {
+  uint32_t steps = 0;
+  for (uint32_t end = *t + durationMs; *t < end; *t += PERIOD_MS) {
+    if (detector.push(sq(ms2), *t)) steps++;
+  }
+  return steps;
+}
+
+// Marcha sinusoidal: g + amplitude * sin(2π f t) durante 'seconds'
+static uint32_t walk(StepDetector &detector, float amplitude, float stepHz, float seconds, uint32_t *t) {
+  uint32_t steps = 0;
+  for (uint32_t end = *t + (uint32_t)(seconds * 1000); *t < end; *t += PERIOD_MS) {
+    float ms2 = 9.80665F + amplitude * sinf(2 * (float)M_PI * stepHz * *t / 1000.0F);
+    if (detector.push(sq(ms2), *t)) steps++;
+  }
+  return steps;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_step_needs_high_then_low_crossing(void) {
+  StepDetector detector(plainConfig());
+  uint32_t t = 1000;
+
+  // Por debajo del umbral alto no se arma nada
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 11.0F, 200, &t));
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 9.0F, 200, &t));
+  // Por encima del alto se arma, pero el paso no cuenta hasta bajar del bajo
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 13.0F, 100, &t));
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 10.0F, 100, &t));
+  TEST_ASSERT_EQUAL_UINT32(1, hold(detector, 9.0F, 100, &t));
+  TEST_ASSERT_EQUAL_UINT32(1, detector.steps());
+  TEST_ASSERT_EQUAL_UINT32(t - 100, detector.lastStepTime());
+  TEST_ASSERT_EQUAL_UINT32(0, detector.lastIntervalMs());
+  TEST_ASSERT_EQUAL_UINT32(sq(13.0F), detector.lastPeakSq());
+}
+
+void test_debounce_ignores_peaks_inside_window(void) {
+  StepDetector detector(plainConfig());
+  uint32_t t = 1000;
+
+  TEST_ASSERT_EQUAL_UINT32(1, hold(detector, 13.0F, 30, &t) + hold(detector, 9.0F, 30, &t));
+  uint32_t first = detector.lastStepTime();
+
+  // Pico completo 200 ms después del paso: dentro de DEBOUNCE_TIME_MS, no cuenta
+  t = first + 200;
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 13.0F, 30, &t) + hold(detector, 9.0F, 100, &t));
+
+  // Pasada la ventana vuelve a contar, y el intervalo se mide desde el primer paso
+  t = first + DEBOUNCE_TIME_MS + 50;
+  TEST_ASSERT_EQUAL_UINT32(1, hold(detector, 13.0F, 30, &t) + hold(detector, 9.0F, 30, &t));
+  TEST_ASSERT_EQUAL_UINT32(2, detector.steps());
+  TEST_ASSERT_EQUAL_UINT32(detector.lastStepTime() - first, detector.lastIntervalMs());
+}
+
+void test_block_path_matches_per_sample_path(void) {
+  StepDetector::Config cfg = plainConfig();
+  cfg.filterEnabled = true;
+  StepDetector single(cfg);
+  StepDetector blocked(cfg);
+
+  const size_t N = 1000;
+  static RawSample samples[N];
+  for (size_t i = 0; i < N; i++) {
+    float ms2 = 9.80665F + 4.0F * sinf(2 * (float)M_PI * 1.8F * i * PERIOD_MS / 1000.0F);
+    samples[i] = RawSample{(uint32_t)(i * PERIOD_MS), 0, 0, (int16_t)(ms2 / ACCEL_MS2_PER_COUNT_2G)};
+  }
+
+  uint32_t singleSteps = 0;
+  for (size_t i = 0; i < N; i++) {
+    if (single.push(samples[i])) singleSteps++;
+  }
+  uint32_t blockSteps = 0;
+  // Tamaño de ráfaga que no es múltiplo de BLOCK_SIZE para cruzar los bordes de bloque
+  for (size_t i = 0; i < N; i += 45) {
+    size_t n = N - i < 45 ? N - i : 45;
+    blocked.pushBlock(&samples[i], n, [&](const RawSample &) { blockSteps++; });
+  }
+
+  TEST_ASSERT_GREATER_THAN_UINT32(0, singleSteps);
+  TEST_ASSERT_EQUAL_UINT32(singleSteps, blockSteps);
+  TEST_ASSERT_EQUAL_UINT32(single.lastStepTime(), blocked.lastStepTime());
+}
+
+void test_adaptive_thresholds_follow_weak_gait(void) {
+  // Marcha arrastrando los pies: picos de ~11.3 m/s², nunca llega al umbral fijo de 12
+  StepDetector::Config fixedCfg = plainConfig();
+  StepDetector::Config adaptiveCfg = plainConfig();
+  adaptiveCfg.adaptive = true;
+  StepDetector fixed(fixedCfg);
+  StepDetector adaptive(adaptiveCfg);
+
+  uint32_t tFixed = 0;
+  uint32_t tAdaptive = 0;
+  uint32_t fixedSteps = walk(fixed, 1.5F, 1.8F, 20, &tFixed);
+  uint32_t adaptiveSteps = walk(adaptive, 1.5F, 1.8F, 20, &tAdaptive);
+
+  TEST_ASSERT_EQUAL_UINT32(0, fixedSteps);
+  // 36 pasos en 20 s; los primeros se pierden mientras las envolventes se ajustan
+  TEST_ASSERT_UINT32_WITHIN(4, 34, adaptiveSteps);
+  TEST_ASSERT_LESS_THAN_UINT32(fixedCfg.highThresholdSq, adaptive.highThresholdSq());
+}
+
+void test_adaptive_thresholds_ignore_noise_at_rest(void) {
+  StepDetector::Config cfg = plainConfig();
+  cfg.adaptive = true;
+  StepDetector detector(cfg);
+
+  uint32_t t = 0;
+  // Parado: ruido de ±0.3 m/s², por debajo de ADAPTIVE_MIN_SWING
+  TEST_ASSERT_EQUAL_UINT32(0, walk(detector, 0.3F, 7.0F, 20, &t));
+  TEST_ASSERT_GREATER_THAN_UINT32(sq(9.80665F + 0.3F), detector.highThresholdSq());
+}
+
+// Marcha a 2 pasos/s con un rebote 200 ms después de cada paso; el rebote pasa el
+// umbral pero es más débil que el paso
+static uint32_t walkWithBounce(StepDetector &detector, uint32_t fromMs, uint32_t toMs) {
+  uint32_t steps = 0;
+  for (uint32_t t = fromMs; t < toMs; t += PERIOD_MS) {
+    uint32_t phase = t % 500;
+    float ms2 = phase < 40 ? 20.0F : (phase >= 200 && phase < 210) ? 12.5F : 9.0F;
+    if (detector.push(sq(ms2), t)) steps++;
+  }
+  return steps;
+}
+
+void test_cadence_gate_rejects_early_peaks(void) {
+  // Rebote de 100 ms para que no lo quite ya el tiempo de rebote
+  StepDetector::Config cfg = plainConfig();
+  cfg.debounceMs = 100;
+  StepDetector ungated(cfg);
+  cfg.cadenceGate = true;
+  StepDetector gated(cfg);
+
+  // Mientras el estimador acumula historia el filtro deja pasar todos los picos
+  walkWithBounce(ungated, 0, 10000);
+  walkWithBounce(gated, 0, 10000);
+  TEST_ASSERT_TRUE(gated.cadence().ready());
+  TEST_ASSERT_UINT32_WITHIN(25, 500, gated.cadence().periodMs());
+
+  // En 10 s: 20 pasos; sin filtro cada rebote cuenta como otro paso
+  TEST_ASSERT_EQUAL_UINT32(40, walkWithBounce(ungated, 10000, 20000));
+  uint32_t rejectedBefore = gated.rejectedPeaks();
+  TEST_ASSERT_EQUAL_UINT32(20, walkWithBounce(gated, 10000, 20000));
+  TEST_ASSERT_EQUAL_UINT32(20, gated.rejectedPeaks() - rejectedBefore);
+}
+
+void test_cadence_gate_rejects_isolated_peak(void) {
+  StepDetector::Config cfg = plainConfig();
+  cfg.cadenceGate = true;
+  StepDetector detector(cfg);
+
+  // Parado el tiempo suficiente para que el estimador tenga historia, sin periodicidad
+  uint32_t t = 0;
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 9.0F, 5000, &t));
+  TEST_ASSERT_TRUE(detector.cadence().ready());
+
+  // Un golpe aislado no es un paso...
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 13.0F, 30, &t) + hold(detector, 9.0F, 770, &t));
+  TEST_ASSERT_EQUAL_UINT32(1, detector.rejectedPeaks());
+  // ...pero otro pico a distancia de paso sí lo es
+  TEST_ASSERT_EQUAL_UINT32(1, hold(detector, 13.0F, 30, &t) + hold(detector, 9.0F, 100, &t));
+  TEST_ASSERT_EQUAL_UINT32(1, detector.steps());
+}
+
+void test_reset_clears_count_and_state(void) {
+  StepDetector detector(plainConfig());
+  uint32_t t = 1000;
+  hold(detector, 13.0F, 30, &t);
+  hold(detector, 9.0F, 30, &t);
+  // Armado a medias antes del reset: no debe completar un paso después
+  hold(detector, 13.0F, 30, &t);
+  detector.reset();
+
+  TEST_ASSERT_EQUAL_UINT32(0, detector.steps());
+  TEST_ASSERT_EQUAL_UINT32(0, hold(detector, 9.0F, 100, &t));
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_step_needs_high_then_low_crossing);
+  RUN_TEST(test_debounce_ignores_peaks_inside_window);
+  RUN_TEST(test_block_path_matches_per_sample_path);
+  RUN_TEST(test_adaptive_thresholds_follow_weak_gait);
+  RUN_TEST(test_adaptive_thresholds_ignore_noise_at_rest);
+  RUN_TEST(test_cadence_gate_rejects_early_peaks);
+  RUN_TEST(test_cadence_gate_rejects_isolated_peak);
+  RUN_TEST(test_reset_clears_count_and_state);
+  return UNITY_END();
+}
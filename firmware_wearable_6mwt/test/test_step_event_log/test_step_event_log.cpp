@@ -0,0 +1,88 @@
+#include <unity.h>
+
+#include <thread>
+#include <StepEventLog.h>
+
+// Pruebas del historial de eventos: búsqueda por número de paso, sobrescritura de los
+// más antiguos y un escritor y un lector en hilos distintos, como la detección y las
+// notificaciones en el ESP32
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static StepEvent eventFor(uint32_t steps) {
+  StepEvent event = {};
+  event.t_ms = steps * 500;
+  event.steps = steps;
+  event.intervalMs = 500;
+  event.distanceMm = steps * 700;
+  return event;
+}
+
+void test_empty_log_has_nothing_to_read(void) {
+  StepEventLog<8> log;
+  StepEvent event;
+  TEST_ASSERT_EQUAL_UINT32(0, log.newest());
+  TEST_ASSERT_FALSE(log.contains(1));
+  TEST_ASSERT_FALSE(log.read(1, event));
+}
+
+void test_read_by_step_number(void) {
+  StepEventLog<8> log;
+  for (uint32_t k = 1; k <= 5; k++) log.append(eventFor(k));
+
+  StepEvent event;
+  TEST_ASSERT_EQUAL_UINT32(1, log.oldest());
+  TEST_ASSERT_EQUAL_UINT32(5, log.newest());
+  TEST_ASSERT_TRUE(log.read(3, event));
+  TEST_ASSERT_EQUAL_UINT32(3, event.steps);
+  TEST_ASSERT_EQUAL_UINT32(1500, event.t_ms);
+  TEST_ASSERT_FALSE(log.read(6, event));
+}
+
+void test_full_log_drops_oldest(void) {
+  StepEventLog<8> log;
+  for (uint32_t k = 1; k <= 20; k++) log.append(eventFor(k));
+
+  // El hueco que el siguiente append() va a pisar ya no se puede leer
+  StepEvent event;
+  TEST_ASSERT_EQUAL_UINT32(14, log.oldest());
+  TEST_ASSERT_FALSE(log.read(13, event));
+  for (uint32_t k = 14; k <= 20; k++) {
+    TEST_ASSERT_TRUE(log.read(k, event));
+    TEST_ASSERT_EQUAL_UINT32(k, event.steps);
+  }
+}
+
+void test_reader_never_accepts_overwritten_event(void) {
+  static StepEventLog<16> log;
+  const uint32_t STEPS = 1000000;
+
+  std::thread writer([&]() {
+    for (uint32_t k = 1; k <= STEPS; k++) log.append(eventFor(k));
+  });
+
+  // Lee siempre el más antiguo, el que más cerca está de sobrescribirse
+  uint32_t errors = 0;
+  uint32_t reads = 0;
+  StepEvent event;
+  while (log.newest() < STEPS) {
+    uint32_t step = log.oldest();
+    if (!log.read(step, event)) continue;
+    reads++;
+    if (event.steps != step || event.t_ms != step * 500 || event.distanceMm != step * 700) errors++;
+  }
+  writer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, errors);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, reads);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_log_has_nothing_to_read);
+  RUN_TEST(test_read_by_step_number);
+  RUN_TEST(test_full_log_drops_oldest);
+  RUN_TEST(test_reader_never_accepts_overwritten_event);
+  return UNITY_END();
+}
@@ -0,0 +1,93 @@
+#include <unity.h>
+
+#include <ByteOrder.h>
+#include <StepEventPacket.h>
+
+// Pruebas del formato de las notificaciones de eventos de paso (versión 2)
+
+static StepEvent eventAt(uint32_t i) {
+  return StepEvent{1000 + i * 500, i + 1, (uint16_t)(1200 + i), 500, (uint16_t)(650 + i), (i + 1) * 650};
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_event_layout(void) {
+  StepEventPacker packer;
+  packer.setMaxSize(StepEventPacker::MAX_PACKET_SIZE);
+  StepEvent event{123456, 42, 1500, 0xFFFF, 700, 29400};
+  TEST_ASSERT_TRUE(packer.append(event));
+
+  const uint8_t *p = packer.data();
+  TEST_ASSERT_EQUAL_size_t(StepEventPacker::HEADER_SIZE + StepEventPacker::EVENT_SIZE, packer.size());
+  TEST_ASSERT_EQUAL_UINT8(StepEventPacker::VERSION, p[0]);
+  TEST_ASSERT_EQUAL_UINT8(1, p[1]);
+  TEST_ASSERT_EQUAL_UINT16(0, getLe16(&p[2]));
+  p += StepEventPacker::HEADER_SIZE;
+  TEST_ASSERT_EQUAL_UINT32(123456, getLe32(p));
+  TEST_ASSERT_EQUAL_UINT32(42, getLe32(p + 4));
+  TEST_ASSERT_EQUAL_UINT16(1500, getLe16(p + 8));
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, getLe16(p + 10));
+  TEST_ASSERT_EQUAL_UINT32(29400, getLe32(p + 12));
+}
+
+void test_default_mtu_carries_one_event(void) {
+  StepEventPacker packer;
+  // MTU de 23 bytes: 20 de carga en cada notificación
+  packer.setMaxSize(23 - 3);
+  TEST_ASSERT_TRUE(packer.append(eventAt(0)));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(20, packer.size());
+  TEST_ASSERT_TRUE(packer.full());
+  TEST_ASSERT_FALSE(packer.append(eventAt(1)));
+  TEST_ASSERT_EQUAL_UINT8(1, packer.count());
+}
+
+void test_batches_up_to_max_size(void) {
+  StepEventPacker packer;
+  packer.setMaxSize(StepEventPacker::MAX_PACKET_SIZE);
+  size_t fit = (StepEventPacker::MAX_PACKET_SIZE - StepEventPacker::HEADER_SIZE) / StepEventPacker::EVENT_SIZE;
+  for (uint32_t i = 0; i < fit; i++) TEST_ASSERT_TRUE(packer.append(eventAt(i)));
+  TEST_ASSERT_FALSE(packer.append(eventAt((uint32_t)fit)));
+  TEST_ASSERT_EQUAL_UINT8(fit, packer.count());
+
+  // El último evento queda en su sitio
+  const uint8_t *last = packer.data() + StepEventPacker::HEADER_SIZE + (fit - 1) * StepEventPacker::EVENT_SIZE;
+  TEST_ASSERT_EQUAL_UINT32(eventAt((uint32_t)fit - 1).t_ms, getLe32(last));
+}
+
+void test_clear_advances_sequence_only_when_sent(void) {
+  StepEventPacker packer;
+  packer.clear();
+  TEST_ASSERT_EQUAL_UINT16(0, packer.sequence());
+
+  packer.append(eventAt(0));
+  packer.clear();
+  TEST_ASSERT_EQUAL_UINT16(1, packer.sequence());
+  TEST_ASSERT_EQUAL_size_t(0, packer.size());
+  TEST_ASSERT_EQUAL_UINT8(0, packer.count());
+
+  packer.append(eventAt(1));
+  TEST_ASSERT_EQUAL_UINT16(1, getLe16(&packer.data()[2]));
+}
+
+void test_max_size_is_clamped(void) {
+  StepEventPacker packer;
+  // Nunca por debajo de un evento ni por encima del buffer
+  packer.setMaxSize(5);
+  TEST_ASSERT_TRUE(packer.append(eventAt(0)));
+  packer.clear();
+  packer.setMaxSize(1000);
+  uint32_t n = 0;
+  while (packer.append(eventAt(n))) n++;
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(StepEventPacker::MAX_PACKET_SIZE, packer.size());
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_event_layout);
+  RUN_TEST(test_default_mtu_carries_one_event);
+  RUN_TEST(test_batches_up_to_max_size);
+  RUN_TEST(test_clear_advances_sequence_only_when_sent);
+  RUN_TEST(test_max_size_is_clamped);
+  return UNITY_END();
+}
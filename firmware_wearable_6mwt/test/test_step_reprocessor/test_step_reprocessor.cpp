@@ -0,0 +1,142 @@
+#include <unity.h>
+
+#include <math.h>
+#include <vector>
+#include <StepDetector.h>
+#include <StepReprocessor.h>
+
+// Pruebas del reprocesado no causal sobre historiales sintéticos a 100 Hz
+
+static const uint32_t PERIOD_MS = 10;
+static const float G = 9.80665F;
+static const float K = 0.41F;
+
+static std::vector<HistoryEntry> storage;
+static HistoryBuffer history;
+static std::vector<uint8_t> workspace;
+
+// Añade una muestra con ese módulo en m/s² (todo en el eje z)
+static void appendMs2(uint32_t t_ms, float ms2) {
+  RawSample sample{t_ms, 0, 0, (int16_t)(ms2 / ACCEL_MS2_PER_COUNT_2G)};
+  uint32_t signal = magnitudeSquared(sample);
+  history.append(&sample, &signal, 1);
+}
+
+// Marcha a stepHz con un segundo pico del talón 'bounceMs' después de cada paso
+// (0 = sin rebote); devuelve el instante siguiente
+static uint32_t walk(uint32_t t, float seconds, float stepHz, uint32_t bounceMs) {
+  uint32_t periodMs = (uint32_t)(1000.0F / stepHz);
+  for (uint32_t end = t + (uint32_t)(seconds * 1000); t < end; t += PERIOD_MS) {
+    float phase = 2 * (float)M_PI * (float)(t % periodMs) / (float)periodMs;
+    float ms2 = G + 2.5F * sinf(phase);
+    if (bounceMs > 0) {
+      float d = ((float)(t % periodMs) - (float)(periodMs / 4 + bounceMs)) / 30.0F;
+      ms2 += 1.5F * expf(-d * d);
+    }
+    appendMs2(t, ms2);
+  }
+  return t;
+}
+
+static uint32_t stand(uint32_t t, float seconds) {
+  for (uint32_t end = t + (uint32_t)(seconds * 1000); t < end; t += PERIOD_MS) {
+    appendMs2(t, G + 0.05F * sinf((float)t * 0.37F));
+  }
+  return t;
+}
+
+static StepReprocessor::Result reprocess() {
+  StepReprocessor reprocessor(StepReprocessor::defaultConfig(ACCEL_MS2_PER_COUNT_2G, K));
+  workspace.assign(StepReprocessor::workspaceBytes(history.end() - history.begin()), 0);
+  return reprocessor.run(history, history.begin(), history.end(), workspace.data(), workspace.size());
+}
+
+void setUp(void) {
+  storage.assign(20000, HistoryEntry());
+  history.attach(storage.data(), storage.size(), false);
+}
+
+void tearDown(void) {}
+
+void test_counts_steady_walk(void) {
+  uint32_t t = stand(0, 2);
+  t = walk(t, 60, 1.8F, 0);
+  stand(t, 2);
+
+  StepReprocessor::Result result = reprocess();
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::DONE, result.status);
+  TEST_ASSERT_UINT32_WITHIN(2, 108, result.steps);
+  TEST_ASSERT_EQUAL_UINT32(0, result.fromMs);
+  TEST_ASSERT_EQUAL_UINT32(history.end() - history.begin(), result.samples);
+  TEST_ASSERT_EQUAL_UINT32((result.samples - 1) * PERIOD_MS, result.toMs);
+  // Weinberg con una oscilación de ±2.5 m/s² filtrada: del orden de medio metro por paso
+  TEST_ASSERT_GREATER_THAN_UINT32(result.steps * 300, result.distanceMm);
+  TEST_ASSERT_LESS_THAN_UINT32(result.steps * 1000, result.distanceMm);
+}
+
+void test_heel_double_peak_counts_once(void) {
+  uint32_t t = stand(0, 2);
+  t = walk(t, 40, 1.6F, 120);
+  stand(t, 2);
+
+  StepReprocessor::Result result = reprocess();
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::DONE, result.status);
+  TEST_ASSERT_UINT32_WITHIN(2, 64, result.steps);
+}
+
+void test_pause_splits_the_walk(void) {
+  uint32_t t = stand(0, 2);
+  t = walk(t, 20, 2.0F, 0);
+  t = stand(t, 15);
+  t = walk(t, 20, 2.0F, 0);
+  stand(t, 2);
+
+  StepReprocessor::Result result = reprocess();
+  TEST_ASSERT_UINT32_WITHIN(3, 80, result.steps);
+}
+
+void test_rest_has_no_steps(void) {
+  stand(0, 30);
+  StepReprocessor::Result result = reprocess();
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::DONE, result.status);
+  TEST_ASSERT_EQUAL_UINT32(0, result.steps);
+  TEST_ASSERT_EQUAL_UINT32(0, result.distanceMm);
+}
+
+void test_live_steps_come_from_history_flags(void) {
+  uint32_t t = walk(0, 10, 2.0F, 0);
+  history.markStep(t - PERIOD_MS);
+  history.markStep(t - 5 * PERIOD_MS);
+  TEST_ASSERT_EQUAL_UINT32(2, reprocess().liveSteps);
+}
+
+void test_error_statuses(void) {
+  StepReprocessor reprocessor(StepReprocessor::defaultConfig(ACCEL_MS2_PER_COUNT_2G, K));
+  uint8_t small[16];
+
+  // Historial vacío o ventana de un par de muestras
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::NO_DATA, reprocessor.run(history, 0, 0, small, sizeof(small)).status);
+  walk(0, 250, 2.0F, 0);
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::NO_DATA,
+                          reprocessor.run(history, history.end() - 2, history.end(), small, sizeof(small)).status);
+  // Sin memoria de trabajo suficiente
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::NO_MEMORY,
+                          reprocessor.run(history, history.end() - 100, history.end(), small, sizeof(small)).status);
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::NO_MEMORY,
+                          reprocessor.run(history, history.end() - 100, history.end(), NULL, 0).status);
+  // El principio de la ventana ya se sobrescribió (25000 muestras en 20000 entradas)
+  workspace.assign(StepReprocessor::workspaceBytes(1000), 0);
+  TEST_ASSERT_EQUAL_UINT8(StepReprocessor::OVERWRITTEN,
+                          reprocessor.run(history, 0, 1000, workspace.data(), workspace.size()).status);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counts_steady_walk);
+  RUN_TEST(test_heel_double_peak_counts_once);
+  RUN_TEST(test_pause_splits_the_walk);
+  RUN_TEST(test_rest_has_no_steps);
+  RUN_TEST(test_live_steps_come_from_history_flags);
+  RUN_TEST(test_error_statuses);
+  return UNITY_END();
+}
@@ -0,0 +1,89 @@
+#include <unity.h>
+
+#include <string.h>
+#include <TlvWriter.h>
+
+// Pruebas del contenedor TLV de la característica de diagnóstico
+
+// Busca una sección como lo haría el cliente: saltando las etiquetas que no conoce
+static const uint8_t *findSection(const uint8_t *buffer, size_t size, uint8_t tag, uint8_t *length) {
+  size_t pos = 1;
+  while (pos + 2 <= size) {
+    uint8_t t = buffer[pos];
+    uint8_t len = buffer[pos + 1];
+    if (pos + 2 + len > size) return NULL;
+    if (t == tag) {
+      *length = len;
+      return &buffer[pos + 2];
+    }
+    pos += 2 + len;
+  }
+  return NULL;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_writer_holds_version(void) {
+  uint8_t buffer[16];
+  TlvWriter writer(buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL_size_t(1, writer.size());
+  TEST_ASSERT_EQUAL_UINT8(TlvWriter::VERSION, buffer[0]);
+}
+
+void test_sections_are_tagged_and_skippable(void) {
+  uint8_t buffer[64];
+  TlvWriter writer(buffer, sizeof(buffer));
+
+  uint8_t *link = writer.section(DIAG_TAG_LINK, 3);
+  TEST_ASSERT_NOT_NULL(link);
+  memset(link, 0xAA, 3);
+  // Etiqueta desconocida para el cliente entre medias
+  uint8_t *unknown = writer.section(0x7F, 5);
+  TEST_ASSERT_NOT_NULL(unknown);
+  memset(unknown, 0x55, 5);
+  uint8_t *history = writer.section(DIAG_TAG_HISTORY, 2);
+  TEST_ASSERT_NOT_NULL(history);
+  history[0] = 1;
+  history[1] = 2;
+
+  TEST_ASSERT_EQUAL_size_t(1 + (2 + 3) + (2 + 5) + (2 + 2), writer.size());
+  uint8_t length = 0;
+  const uint8_t *found = findSection(buffer, writer.size(), DIAG_TAG_HISTORY, &length);
+  TEST_ASSERT_NOT_NULL(found);
+  TEST_ASSERT_EQUAL_UINT8(2, length);
+  TEST_ASSERT_EQUAL_UINT8(1, found[0]);
+  TEST_ASSERT_EQUAL_UINT8(2, found[1]);
+  TEST_ASSERT_TRUE(findSection(buffer, writer.size(), DIAG_TAG_TIMING, &length) == NULL);
+}
+
+void test_section_that_does_not_fit_is_refused_whole(void) {
+  uint8_t buffer[10];
+  TlvWriter writer(buffer, sizeof(buffer));
+  TEST_ASSERT_NOT_NULL(writer.section(DIAG_TAG_LINK, 4));
+  TEST_ASSERT_EQUAL_size_t(7, writer.size());
+
+  // Faltan bytes: ni cabecera a medias ni cambio de tamaño
+  TEST_ASSERT_TRUE(writer.section(DIAG_TAG_NOTIFY, 2) == NULL);
+  TEST_ASSERT_EQUAL_size_t(7, writer.size());
+  // Una sección más corta sí cabe justo
+  TEST_ASSERT_NOT_NULL(writer.section(DIAG_TAG_NOTIFY, 1));
+  TEST_ASSERT_EQUAL_size_t(10, writer.size());
+}
+
+void test_zero_capacity_writes_nothing(void) {
+  uint8_t buffer[1] = {0xEE};
+  TlvWriter writer(buffer, 0);
+  TEST_ASSERT_EQUAL_size_t(0, writer.size());
+  TEST_ASSERT_TRUE(writer.section(DIAG_TAG_LINK, 0) == NULL);
+  TEST_ASSERT_EQUAL_UINT8(0xEE, buffer[0]);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_writer_holds_version);
+  RUN_TEST(test_sections_are_tagged_and_skippable);
+  RUN_TEST(test_section_that_does_not_fit_is_refused_whole);
+  RUN_TEST(test_zero_capacity_writes_nothing);
+  return UNITY_END();
+}
@@ -0,0 +1,249 @@
+// Banco de medida en el propio XIAO ESP32-S3 para el procesado de lib/.
+//
+// Genera una marcha sintética en RAM (sin sensor ni BLE) y mide, con el contador de
+// ciclos del núcleo, el coste por muestra de cada etapa. El resultado sale por el
+// puerto serie; se compila y carga con su propio entorno:
+//
+//   pio run -e bench_esp32s3 -t upload -t monitor
+//
+// A 119 Hz y 240 MHz el periodo de muestra equivale a ~2 millones de ciclos.
+//
+// Los núcleos de bloque se miden en bloques de 32, 64 y 128 muestras, en su versión
+// escalar y en la que usa el firmware (vectorial con esp-dsp si BLOCK_KERNELS_SIMD);
+// del módulo² vectorial se imprime además el mayor error frente al escalar.
+
+#include <Arduino.h>
+#include <math.h>
+#include <StepDetector.h>
+#include <BlockKernels.h>
+#include <GravityEstimator.h>
+#include <TimingProfile.h>
+
+static const size_t BENCH_SAMPLES = 2048;
+static const int BENCH_REPEAT = 8;
+
+static RawSample samples[BENCH_SAMPLES];
+static uint32_t magnitudes[BENCH_SAMPLES];
+static uint32_t blockOut[BENCH_SAMPLES];
+static float features[BENCH_SAMPLES];
+static volatile uint32_t sink; // Evita que el compilador elimine el trabajo medido
+
+// Marcha a ~1.8 pasos/s con ruido, en cuentas de ±2g
+static void makeTrace() {
+  const float countsPerMs2 = 1.0F / ACCEL_MS2_PER_COUNT_2G;
+  uint32_t seed = 1;
+  for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+    float t = i / ACCEL_SAMPLE_RATE_HZ;
+    seed = seed * 1664525 + 1013904223;
+    float noise = ((int32_t)(seed >> 16) - 32768) / 32768.0F * 0.5F;
+    float a = 9.81F + 4.0F * sinf(2 * PI * 1.8F * t) + noise;
+    samples[i].t_ms = (uint32_t)(t * 1000);
+    samples[i].x = (int16_t)(a * 0.3F * countsPerMs2);
+    samples[i].y = (int16_t)(noise * countsPerMs2);
+    samples[i].z = (int16_t)(a * 0.95F * countsPerMs2);
+  }
+}
+
+static void report(const char *name, uint32_t cycles) {
+  float perSample = (float)cycles / (BENCH_SAMPLES * BENCH_REPEAT);
+  Serial.printf("%-24s %10.1f ciclos/muestra %8.3f us/muestra\n",
+                name, perSample, perSample / getCpuFrequencyMhz());
+}
+
+static void benchDetector(const char *name, const StepDetector::Config &config) {
+  StepDetector detector(config);
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    detector.reset();
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) detector.push(samples[i]);
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = detector.steps();
+  report(name, cycles);
+}
+
+static void benchFilter() {
+  StepFilter filter(StepDetector::defaultConfig().filter);
+  int32_t acc = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+      acc += filter.process((int32_t)(magnitudeSquared(samples[i]) >> STEP_FILTER_INPUT_SHIFT));
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = acc;
+  report("biquads (solo filtro)", cycles);
+}
+
+// Señal de entrada del detector: módulo con raíz (como antes de user-004), módulo² y
+// componente vertical² en float y en coma fija
+static void benchSqrtMagnitude() {
+  float acc = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) acc += sqrtf((float)magnitudeSquared(samples[i]));
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = (uint32_t)acc;
+  report("módulo con sqrtf", cycles);
+}
+
+static void benchSquaredMagnitude() {
+  uint32_t acc = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) acc += magnitudeSquared(samples[i]);
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = acc;
+  report("módulo²", cycles);
+}
+
+template <typename Estimator>
+static void benchVertical(const char *name, bool withGyro) {
+  Estimator gravity(ACCEL_SAMPLE_RATE_HZ);
+  const RawGyroSample gyro = {120, -40, 15};
+  uint32_t acc = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+      acc += gravity.verticalSq(samples[i], withGyro ? &gyro : NULL);
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = acc;
+  report(name, cycles);
+}
+
+static void benchBlockFilter(size_t block) {
+  StepFilter filter(StepDetector::defaultConfig().filter);
+  static int32_t buffer[BENCH_SAMPLES];
+  for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+    buffer[i] = (int32_t)(magnitudes[i] >> STEP_FILTER_INPUT_SHIFT);
+  }
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i += block) {
+      filter.processBlock(&buffer[i], &buffer[i], block);
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = buffer[0];
+  report("biquads en bloque", cycles);
+}
+
+static void benchMagnitude(const char *name, void (*magnitude)(const RawSample *, uint32_t *, size_t),
+                           size_t block) {
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i += block) {
+      magnitude(&samples[i], &blockOut[i], block);
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = blockOut[0];
+  report(name, cycles);
+}
+
+// Mayor diferencia del módulo² de bloque frente al exacto (magnitudes), en cuentas²
+static void reportMagnitudeError() {
+  blockMagnitudeSquared(samples, blockOut, BENCH_SAMPLES);
+  uint32_t worst = 0;
+  for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+    uint32_t diff = magnitudes[i] - blockOut[i];
+    if (diff > worst) worst = diff;
+  }
+  Serial.printf("%-24s %10lu cuentas² (%.2e de g²)\n", "error módulo² SIMD", (unsigned long)worst,
+                worst * (double)ACCEL_MS2_PER_COUNT_2G * ACCEL_MS2_PER_COUNT_2G / (9.80665 * 9.80665));
+}
+
+static void benchDot(const char *name, float (*dot)(const float *, const float *, size_t),
+                     size_t block) {
+  float acc = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    // Producto de cada bloque con el siguiente, como en una autocorrelación
+    for (size_t i = 0; i < BENCH_SAMPLES; i += block) {
+      acc += dot(&features[i], &features[(i + block) % BENCH_SAMPLES], block);
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = (uint32_t)acc;
+  report(name, cycles);
+}
+
+static void benchSums(const char *name, void (*sums)(const float *, size_t, float &, float &),
+                      size_t block) {
+  float sum = 0, sumSq = 0, acc = 0;
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i += block) {
+      sums(&features[i], block, sum, sumSq);
+      acc += sum + sumSq;
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = (uint32_t)acc;
+  report(name, cycles);
+}
+
+// Coste de la instrumentación de tiempos del firmware: una medida con TimingScope por
+// muestra, como lo que añade TIMING_INSTRUMENTATION a cada etapa
+static void benchTimingScope() {
+  static const char *const names[] = {"bench"};
+  static TimingProfile profile(names, 1, getCpuFrequencyMhz());
+  uint32_t start = ESP.getCycleCount();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+      TimingScope scope(profile, 0);
+    }
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  sink = profile.stage(0).count();
+  report("medida TimingScope", cycles);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000); // Tiempo para abrir el monitor serie tras el reinicio
+  makeTrace();
+  blockMagnitudeSquaredScalar(samples, magnitudes, BENCH_SAMPLES);
+  blockToFloat(magnitudes, features, BENCH_SAMPLES, 1.0F / (1 << 20));
+}
+
+void loop() {
+  StepDetector::Config raw = StepDetector::defaultConfig();
+  raw.filterEnabled = false;
+  StepDetector::Config adaptive = StepDetector::defaultConfig();
+  adaptive.adaptive = true;
+
+  Serial.printf("--- %u muestras x %d, CPU a %u MHz ---\n",
+                (unsigned)BENCH_SAMPLES, BENCH_REPEAT, getCpuFrequencyMhz());
+  benchDetector("umbral sin filtro", raw);
+  benchDetector("umbral con biquads", StepDetector::defaultConfig());
+  benchDetector("umbral adaptativo", adaptive);
+  benchFilter();
+  benchSqrtMagnitude();
+  benchSquaredMagnitude();
+  benchVertical<GravityEstimator>("vertical² float", false);
+  benchVertical<GravityEstimator>("vertical² float + giro", true);
+  benchVertical<GravityEstimatorQ>("vertical² Q", false);
+  benchVertical<GravityEstimatorQ>("vertical² Q + giro", true);
+  benchTimingScope();
+  reportMagnitudeError();
+
+  static const size_t BLOCKS[] = {32, 64, 128};
+  for (size_t block : BLOCKS) {
+    Serial.printf("--- bloques de %u muestras (SIMD %s) ---\n",
+                  (unsigned)block, BLOCK_KERNELS_SIMD ? "esp-dsp" : "no disponible");
+    benchMagnitude("módulo² escalar", blockMagnitudeSquaredScalar, block);
+    benchMagnitude("módulo² SIMD", blockMagnitudeSquared, block);
+    benchBlockFilter(block);
+    benchDot("producto escalar escalar", blockDotScalar, block);
+    benchDot("producto escalar SIMD", blockDot, block);
+    benchSums("media/varianza escalar", blockSumsScalar, block);
+    benchSums("media/varianza SIMD", blockSums, block);
+  }
+  delay(5000);
+}
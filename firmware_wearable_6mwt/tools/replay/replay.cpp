@@ -0,0 +1,336 @@
+// Banco de reproducción de trazas del acelerómetro para la detección de pasos.
+//
+// Lee trazas grabadas y las pasa por el detector de lib/ tan rápido como puede,
+// informando del rendimiento (muestras/s, ns por muestra) y del error en el número
+// de pasos frente a las marcas de referencia. Se compila con el entorno nativo:
+//
+//   pio run -e native
+//   .pio/build/native/program [--variant nombre] [--repeat N] [--block N]
+//                             [--max-error-pct P] [--max-error-steps N] traza...
+//
+// Formatos de traza:
+//   .csv  líneas "t_ms,ax,ay,az,step" con ax/ay/az en cuentas del ADC (±2g) y
+//         step = 1 en la muestra donde se produjo un paso real (cabecera opcional)
+//   .bin  registros de 11 bytes little-endian: uint32 t_ms, int16 x, y, z, uint8 step
+//
+// Con --block N las muestras se entregan en bloques de N, como las ráfagas de la FIFO
+// en el firmware, por el camino de bloques del detector (núcleos escalares en el host).
+//
+// Con --max-error-pct el programa termina con código 1 si alguna traza supera ese
+// error relativo, y con --max-error-steps si supera esa diferencia absoluta de pasos,
+// para usarlo como control de regresión. Una traza sin pasos de referencia (p. ej. el
+// paciente parado) tiene error relativo infinito en cuanto se detecta uno.
+
+#include <StepDetector.h>
+#include <StrideEstimator.h>
+#include <GravityEstimator.h>
+#include <StepReprocessor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Trace {
+  std::string name;
+  std::vector<RawSample> samples;
+  uint32_t truthSteps = 0;
+};
+
+// Interfaz común para comparar variantes del algoritmo sobre los mismos datos
+class DetectorVariant {
+  public:
+    virtual ~DetectorVariant() {}
+    virtual void reset() = 0;
+    virtual bool push(const RawSample &sample) = 0;
+    virtual void pushBlock(const RawSample *samples, size_t n) {
+      for (size_t i = 0; i < n; i++) push(samples[i]);
+    }
+    // Fin de la traza: las variantes que no deciden en el momento procesan aquí
+    virtual void finish() {}
+    virtual uint32_t steps() const = 0;
+    // Distancia estimada paso a paso (0 si la variante no la calcula)
+    virtual uint32_t distanceMm() const { return 0; }
+};
+
+class ThresholdVariant : public DetectorVariant {
+  public:
+    explicit ThresholdVariant(const StepDetector::Config &config = StepDetector::defaultConfig())
+        : detector(config) {}
+
+    void reset() override {
+      detector.reset();
+      stride.reset();
+    }
+    bool push(const RawSample &sample) override {
+      if (!detector.push(sample)) return false;
+      onStep();
+      return true;
+    }
+    void pushBlock(const RawSample *samples, size_t n) override {
+      detector.pushBlock(samples, n, [this](const RawSample &) { onStep(); });
+    }
+    uint32_t steps() const override { return detector.steps(); }
+    uint32_t distanceMm() const override { return stride.distanceMm(); }
+
+  private:
+    void onStep() { stride.onStep(detector.lastPeakSq(), detector.lastTroughSq()); }
+
+    StepDetector detector;
+    StrideEstimator stride;
+};
+
+// Detector sobre la componente vertical (sin giroscopio: las trazas solo tienen acelerómetro)
+template <typename Estimator>
+class VerticalVariant : public DetectorVariant {
+  public:
+    VerticalVariant() : gravity(ACCEL_SAMPLE_RATE_HZ) {}
+
+    void reset() override {
+      detector.reset();
+      gravity.reset();
+    }
+    bool push(const RawSample &sample) override {
+      return detector.push(gravity.verticalSq(sample, NULL), sample.t_ms);
+    }
+    void pushBlock(const RawSample *samples, size_t n) override {
+      std::vector<uint32_t> vertical(n);
+      for (size_t i = 0; i < n; i++) vertical[i] = gravity.verticalSq(samples[i], NULL);
+      detector.pushSquaredBlock(samples, vertical.data(), n, [](const RawSample &) {});
+    }
+    uint32_t steps() const override { return detector.steps(); }
+
+  private:
+    StepDetector detector;
+    Estimator gravity;
+};
+
+// Reprocesado de la traza completa al terminar, como tras la prueba en el firmware:
+// las muestras pasan por un HistoryBuffer del tamaño de la traza
+class ReprocessVariant : public DetectorVariant {
+  public:
+    ReprocessVariant()
+        : reprocessor(StepReprocessor::defaultConfig(ACCEL_MS2_PER_COUNT_2G, STRIDE_WEINBERG_K)) {}
+
+    void reset() override {
+      samples.clear();
+      result = StepReprocessor::Result();
+    }
+    bool push(const RawSample &sample) override {
+      samples.push_back(sample);
+      return false;
+    }
+    void finish() override {
+      std::vector<HistoryEntry> storage(samples.size());
+      std::vector<uint32_t> signal(samples.size());
+      HistoryBuffer history;
+      history.attach(storage.data(), storage.size(), false);
+      for (size_t i = 0; i < samples.size(); i++) signal[i] = magnitudeSquared(samples[i]);
+      history.append(samples.data(), signal.data(), samples.size());
+      std::vector<uint8_t> workspace(StepReprocessor::workspaceBytes(samples.size()));
+      result = reprocessor.run(history, history.begin(), history.end(), workspace.data(), workspace.size());
+    }
+    uint32_t steps() const override { return result.steps; }
+    uint32_t distanceMm() const override { return result.distanceMm; }
+
+  private:
+    StepReprocessor reprocessor;
+    std::vector<RawSample> samples;
+    StepReprocessor::Result result = {};
+};
+
+struct VariantEntry {
+  const char *name;
+  std::unique_ptr<DetectorVariant> (*create)();
+};
+
+static const VariantEntry VARIANTS[] = {
+  {"threshold", [] { return std::unique_ptr<DetectorVariant>(new ThresholdVariant()); }},
+  // Umbrales sobre el módulo² sin filtrar, como antes del filtro de biquads
+  {"threshold-raw", [] {
+     StepDetector::Config config = StepDetector::defaultConfig();
+     config.filterEnabled = false;
+     return std::unique_ptr<DetectorVariant>(new ThresholdVariant(config));
+   }},
+  // Contrastando los picos con la cadencia estimada (bit de configuración CADENCE_GATE)
+  {"threshold-gate", [] {
+     StepDetector::Config config = StepDetector::defaultConfig();
+     config.cadenceGate = true;
+     return std::unique_ptr<DetectorVariant>(new ThresholdVariant(config));
+   }},
+  // Componente vertical con la gravedad estimada, en float y en coma fija
+  {"vertical", [] { return std::unique_ptr<DetectorVariant>(new VerticalVariant<GravityEstimator>()); }},
+  {"vertical-q", [] { return std::unique_ptr<DetectorVariant>(new VerticalVariant<GravityEstimatorQ>()); }},
+  // Umbrales que siguen a la media y a las envolventes de la señal
+  {"adaptive", [] {
+     StepDetector::Config config = StepDetector::defaultConfig();
+     config.adaptive = true;
+     return std::unique_ptr<DetectorVariant>(new ThresholdVariant(config));
+   }},
+  // Filtro de fase cero y selección global de picos sobre la traza entera
+  {"reprocess", [] { return std::unique_ptr<DetectorVariant>(new ReprocessVariant()); }},
+};
+
+static bool endsWith(const std::string &s, const char *suffix) {
+  size_t n = strlen(suffix);
+  return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static bool loadCsv(const std::string &path, Trace &trace) {
+  std::ifstream in(path);
+  if (!in) return false;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream fields(line);
+    std::string t, x, y, z, step;
+    if (!std::getline(fields, t, ',') || !std::getline(fields, x, ',') ||
+        !std::getline(fields, y, ',') || !std::getline(fields, z, ',')) {
+      continue;
+    }
+    std::getline(fields, step, ',');
+
+    char *end = NULL;
+    unsigned long tMs = strtoul(t.c_str(), &end, 10);
+    if (end == t.c_str()) continue; // Cabecera u otra línea no numérica
+
+    RawSample s;
+    s.t_ms = (uint32_t)tMs;
+    s.x = (int16_t)atoi(x.c_str());
+    s.y = (int16_t)atoi(y.c_str());
+    s.z = (int16_t)atoi(z.c_str());
+    trace.samples.push_back(s);
+    if (atoi(step.c_str()) != 0) trace.truthSteps++;
+  }
+  return true;
+}
+
+static bool loadBin(const std::string &path, Trace &trace) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+
+  uint8_t r[11];
+  while (in.read(reinterpret_cast<char *>(r), sizeof(r))) {
+    RawSample s;
+    s.t_ms = (uint32_t)r[0] | ((uint32_t)r[1] << 8) | ((uint32_t)r[2] << 16) | ((uint32_t)r[3] << 24);
+    s.x = (int16_t)(r[4] | (r[5] << 8));
+    s.y = (int16_t)(r[6] | (r[7] << 8));
+    s.z = (int16_t)(r[8] | (r[9] << 8));
+    trace.samples.push_back(s);
+    if (r[10] != 0) trace.truthSteps++;
+  }
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr, "uso: program [--variant nombre] [--repeat N] [--block N] "
+                  "[--max-error-pct P] [--max-error-steps N] traza...\n");
+  fprintf(stderr, "variantes:");
+  for (const VariantEntry &v : VARIANTS) fprintf(stderr, " %s", v.name);
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+  const char *variantName = VARIANTS[0].name;
+  int repeat = 20;
+  size_t block = 1;
+  double maxErrorPct = -1;
+  long maxErrorSteps = -1;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--variant") && i + 1 < argc) {
+      variantName = argv[++i];
+    } else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+      repeat = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--block") && i + 1 < argc) {
+      block = (size_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--max-error-pct") && i + 1 < argc) {
+      maxErrorPct = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--max-error-steps") && i + 1 < argc) {
+      maxErrorSteps = atol(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 2;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty() || repeat < 1 || block < 1) {
+    usage();
+    return 2;
+  }
+
+  const VariantEntry *entry = NULL;
+  for (const VariantEntry &v : VARIANTS) {
+    if (!strcmp(v.name, variantName)) entry = &v;
+  }
+  if (entry == NULL) {
+    fprintf(stderr, "variante desconocida: %s\n", variantName);
+    usage();
+    return 2;
+  }
+
+  std::unique_ptr<DetectorVariant> detector = entry->create();
+  bool failed = false;
+
+  printf("%-28s %10s %7s %7s %6s %8s %9s %14s %10s\n",
+         "traza", "muestras", "pasos", "real", "dif", "error%", "dist(m)", "muestras/s", "ns/muestra");
+
+  for (const std::string &path : paths) {
+    Trace trace;
+    trace.name = path;
+    bool ok = endsWith(path, ".bin") ? loadBin(path, trace) : loadCsv(path, trace);
+    if (!ok || trace.samples.empty()) {
+      fprintf(stderr, "no se pudo leer %s\n", path.c_str());
+      failed = true;
+      continue;
+    }
+
+    // La primera pasada da el recuento; las repeticiones solo sirven para medir tiempos
+    uint32_t detected = 0;
+    uint32_t distanceMm = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+      detector->reset();
+      if (block == 1) {
+        for (const RawSample &s : trace.samples) detector->push(s);
+      } else {
+        for (size_t i = 0; i < trace.samples.size(); i += block) {
+          detector->pushBlock(&trace.samples[i], std::min(block, trace.samples.size() - i));
+        }
+      }
+      detector->finish();
+      if (r == 0) {
+        detected = detector->steps();
+        distanceMm = detector->distanceMm();
+      }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double totalSamples = (double)trace.samples.size() * repeat;
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    double nsPerSample = ns / totalSamples;
+    long errorSteps = (long)detected - (long)trace.truthSteps;
+    double errorPct = trace.truthSteps > 0 ? 100.0 * errorSteps / trace.truthSteps
+                      : errorSteps != 0   ? INFINITY
+                                          : 0.0;
+
+    printf("%-28s %10zu %7u %7u %+6ld %+8.2f %9.1f %14.0f %10.2f\n",
+           trace.name.c_str(), trace.samples.size(), detected, trace.truthSteps, errorSteps,
+           errorPct, distanceMm / 1000.0, 1e9 / nsPerSample, nsPerSample);
+
+    if (maxErrorPct >= 0 && std::fabs(errorPct) > maxErrorPct) failed = true;
+    if (maxErrorSteps >= 0 && std::labs(errorSteps) > maxErrorSteps) failed = true;
+  }
+
+  return failed ? 1 : 0;
+}
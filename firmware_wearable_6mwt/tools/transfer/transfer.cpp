@@ -0,0 +1,403 @@
+// Cliente de descarga de sesiones contra un transporte BLE simulado.
+//
+// Ejecuta el FileTransferServer de lib/ (el mismo código que en el wearable) sobre
+// ficheros en memoria y un enlace simulado por eventos de conexión, y lo descarga todo
+// con el cliente de este programa: lista, lee con créditos, comprueba el CRC de cada
+// fragmento y reanuda desde el último offset bueno si falta o llega mal alguno. Al
+// final compara byte a byte lo descargado con el original. Se compila con su entorno:
+//
+//   pio run -e native_transfer
+//   .pio/build/native_transfer/program [opciones] [fichero...]
+//
+// Sin ficheros se sirven dos sesiones sintéticas. Opciones:
+//   --mtu N             MTU acordado (23-247, por defecto 247)
+//   --packets N         notificaciones por evento de conexión (por defecto 6)
+//   --interval-ms X     intervalo de conexión (por defecto 7.5)
+//   --credits N         créditos por lectura (por defecto 32)
+//   --loss P            probabilidad de perder cada fragmento (0-1)
+//   --corrupt P         probabilidad de alterar un byte de cada fragmento (0-1)
+//   --out dir           guarda cada fichero descargado como dir/NNNNN.bin
+//
+// El throughput es el del modelo (fragmentos por evento e intervalo), no el de un
+// enlace real; sirve para comparar MTU, créditos y pérdidas. Termina con código 1 si
+// algún fichero no llega íntegro.
+
+#include <FileTransferServer.h>
+#include <ByteOrder.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Packet;
+
+// Ficheros del "wearable": id consecutivos desde 1
+class MemoryStore : public FileTransferStore {
+  public:
+    void add(const std::vector<uint8_t> &contents) { files.push_back(contents); }
+
+    size_t refresh() override { return files.size(); }
+
+    bool info(size_t index, FileInfo &out) override {
+      if (index >= files.size()) return false;
+      out = FileInfo{(uint16_t)(index + 1), (uint32_t)files[index].size(), 0};
+      return true;
+    }
+
+    bool open(uint16_t id, uint32_t &size) override {
+      if (id == 0 || id > files.size()) return false;
+      current = &files[id - 1];
+      size = (uint32_t)current->size();
+      return true;
+    }
+
+    size_t read(uint32_t offset, uint8_t *out, size_t len) override {
+      if (current == NULL || offset > current->size()) return 0;
+      size_t n = std::min(len, current->size() - offset);
+      memcpy(out, current->data() + offset, n);
+      return n;
+    }
+
+    void close() override { current = NULL; }
+
+    const std::vector<uint8_t> &file(uint16_t id) const { return files[id - 1]; }
+
+  private:
+    std::vector<std::vector<uint8_t>> files;
+    const std::vector<uint8_t> *current = NULL;
+};
+
+// Enlace simulado: las notificaciones de cada evento llegan al cliente al final del
+// evento, en el orden en que se enviaron (como en el único canal ATT de la conexión);
+// los fragmentos de datos se pueden perder o alterar
+class SimulatedLink : public FileTransferLink {
+  public:
+    SimulatedLink(size_t mtu, double loss, double corrupt, uint32_t seed)
+        : mtu(mtu), loss(loss), corrupt(corrupt), rng(seed) {}
+
+    size_t maxPacket() override { return mtu - 3; }
+
+    bool sendControl(const uint8_t *data, size_t len) override {
+      air.push_back(Notification{true, Packet(data, data + len)});
+      return true;
+    }
+
+    bool sendData(const uint8_t *data, size_t len) override {
+      bytesOnAir += len + 3;
+      if (uniform(rng) < loss) {
+        lost++;
+        return true; // El servidor no se entera, como con una notificación real
+      }
+      Packet p(data, data + len);
+      if (uniform(rng) < corrupt) {
+        p[rng() % p.size()] ^= 0x5A;
+        corrupted++;
+      }
+      air.push_back(Notification{false, p});
+      return true;
+    }
+
+    struct Notification {
+      bool control;
+      Packet packet;
+    };
+
+    std::deque<Notification> air;
+    uint64_t bytesOnAir = 0;
+    uint32_t lost = 0;
+    uint32_t corrupted = 0;
+
+  private:
+    size_t mtu;
+    double loss;
+    double corrupt;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> uniform{0.0, 1.0};
+};
+
+// Cliente del protocolo: las peticiones que escribe llegan al servidor en el
+// siguiente evento de conexión
+class TransferClient {
+  public:
+    TransferClient(FileTransferServer &server, uint16_t credits) : server(server), window(credits) {}
+
+    void list() {
+      files.clear();
+      sendList(0);
+      listing = true;
+    }
+
+    void download(uint16_t id) {
+      fileId = id;
+      received.clear();
+      expected = 0;
+      done = false;
+      failed = false;
+      retries = 0;
+      sendRead(0);
+    }
+
+    void onControl(const Packet &p) {
+      idleEvents = 0;
+      if (p.size() < 2) return;
+      uint8_t opcode = p[0] & ~FT_RESPONSE;
+      if (p[1] != FT_OK) {
+        fprintf(stderr, "respuesta 0x%02x con estado %u\n", p[0], p[1]);
+        listing = false;
+        failed = true;
+        return;
+      }
+      if (opcode == FT_OP_LIST) onList(p);
+      if (opcode == FT_OP_READ) onReadResponse(p);
+      if (opcode == FT_OP_DONE) onDone(p);
+    }
+
+    void onData(const Packet &p) {
+      idleEvents = 0;
+      if (!streaming || p.size() < FT_CHUNK_HEADER_SIZE) return;
+      uint32_t offset = getLe32(p.data());
+      uint16_t crc = getLe16(p.data() + 4);
+      uint16_t computed = crc16Update(crc16(p.data(), 4), p.data() + FT_CHUNK_HEADER_SIZE,
+                                      p.size() - FT_CHUNK_HEADER_SIZE);
+      if (offset != expected || crc != computed) {
+        resume();
+        return;
+      }
+      received.insert(received.end(), p.begin() + FT_CHUNK_HEADER_SIZE, p.end());
+      expected += (uint32_t)(p.size() - FT_CHUNK_HEADER_SIZE);
+      // Devolver créditos por tandas: medio bloque en vuelo mientras se procesa el otro
+      if (++consumed >= window / 2) {
+        uint8_t request[3] = {FT_OP_CREDIT};
+        putLe16(request + 1, consumed);
+        server.enqueue(request, sizeof(request));
+        consumed = 0;
+      }
+    }
+
+    // Un evento sin nada que recibir durante una lectura: créditos perdidos con los
+    // fragmentos, o el DONE; tras unos cuantos se reanuda
+    void onIdleEvent() {
+      if ((streaming || awaitingRead) && !done && ++idleEvents > IDLE_EVENTS_TO_RESUME) resume();
+    }
+
+    bool busy() const { return listing || (!done && !failed && fileId != 0); }
+
+    std::vector<FileInfo> files;
+    std::vector<uint8_t> received;
+    uint32_t retries = 0;
+    bool failed = false;
+
+  private:
+    static const uint32_t IDLE_EVENTS_TO_RESUME = 8;
+
+    void sendList(uint16_t first) {
+      uint8_t request[3] = {FT_OP_LIST};
+      putLe16(request + 1, first);
+      server.enqueue(request, sizeof(request));
+    }
+
+    void sendRead(uint32_t from) {
+      uint8_t request[13] = {FT_OP_READ};
+      putLe16(request + 1, fileId);
+      putLe32(request + 3, from);
+      putLe32(request + 7, 0);
+      putLe16(request + 11, window);
+      server.enqueue(request, sizeof(request));
+      streaming = false;
+      awaitingRead = true;
+      consumed = 0;
+      idleEvents = 0;
+    }
+
+    // Lo que siga en vuelo de la lectura anterior se ignora hasta la respuesta del READ
+    void resume() {
+      retries++;
+      uint8_t abort[1] = {FT_OP_ABORT};
+      server.enqueue(abort, sizeof(abort));
+      sendRead(expected);
+    }
+
+    void onList(const Packet &p) {
+      uint16_t first = getLe16(p.data() + 2);
+      uint16_t total = getLe16(p.data() + 4);
+      uint8_t n = p[6];
+      for (uint8_t i = 0; i < n; i++) {
+        const uint8_t *e = p.data() + FT_LIST_HEADER_SIZE + i * FT_LIST_ENTRY_SIZE;
+        files.push_back(FileInfo{getLe16(e), getLe32(e + 2), e[6]});
+      }
+      if (first + n < total && n > 0) {
+        sendList((uint16_t)(first + n));
+      } else {
+        listing = false;
+      }
+    }
+
+    void onReadResponse(const Packet &p) {
+      if (!awaitingRead || p.size() < FT_READ_RESPONSE_SIZE) return;
+      end = getLe32(p.data() + 8);
+      awaitingRead = false;
+      streaming = true;
+    }
+
+    void onDone(const Packet &p) {
+      if (!streaming || p.size() < FT_DONE_SIZE) return;
+      if (expected == end) {
+        done = true;
+        streaming = false;
+      } else {
+        resume(); // Se perdió la cola del fichero
+      }
+    }
+
+    FileTransferServer &server;
+    uint16_t window;
+    bool listing = false;
+    bool awaitingRead = false;
+    bool streaming = false;
+    bool done = false;
+    uint16_t fileId = 0;
+    uint32_t expected = 0;
+    uint32_t end = 0;
+    uint16_t consumed = 0;
+    uint32_t idleEvents = 0;
+};
+
+// Contenido reproducible para probar el transporte; el formato interno de la sesión
+// no interviene en la descarga
+static std::vector<uint8_t> syntheticFile(size_t size, uint32_t seed) {
+  std::vector<uint8_t> out(size);
+  std::mt19937 rng(seed);
+  for (uint8_t &b : out) b = (uint8_t)rng();
+  return out;
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr, "uso: program [--mtu N] [--packets N] [--interval-ms X] [--credits N] "
+                  "[--loss P] [--corrupt P] [--out dir] [fichero...]\n");
+}
+
+int main(int argc, char **argv) {
+  size_t mtu = 247;
+  size_t packetsPerEvent = 6;
+  double intervalMs = 7.5;
+  uint16_t credits = 32;
+  double loss = 0;
+  double corrupt = 0;
+  const char *outDir = NULL;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--mtu") && i + 1 < argc) {
+      mtu = (size_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--packets") && i + 1 < argc) {
+      packetsPerEvent = (size_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--interval-ms") && i + 1 < argc) {
+      intervalMs = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--credits") && i + 1 < argc) {
+      credits = (uint16_t)atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--loss") && i + 1 < argc) {
+      loss = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--corrupt") && i + 1 < argc) {
+      corrupt = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+      outDir = argv[++i];
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 2;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (mtu < 23 || mtu > 247 || packetsPerEvent == 0 || credits < 2) {
+    usage();
+    return 2;
+  }
+
+  MemoryStore store;
+  for (const std::string &path : paths) {
+    std::vector<uint8_t> contents;
+    if (!readFile(path, contents)) {
+      fprintf(stderr, "no se pudo leer %s\n", path.c_str());
+      return 2;
+    }
+    store.add(contents);
+  }
+  if (paths.empty()) {
+    // ~6 min a 119 Hz en registros de 7 bytes por muestra, y uno más corto
+    store.add(syntheticFile(303104, 1));
+    store.add(syntheticFile(40960, 2));
+  }
+
+  SimulatedLink link(mtu, loss, corrupt, 12345);
+  FileTransferServer server(store, link);
+  TransferClient client(server, credits);
+
+  // Un evento de conexión: el servidor envía lo que le permiten créditos y enlace, y
+  // el cliente procesa lo recibido; sus peticiones se atienden en el siguiente
+  uint64_t events = 0;
+  auto runUntilIdle = [&]() {
+    const uint64_t MAX_EVENTS = 10000000;
+    while (client.busy() && events < MAX_EVENTS) {
+      server.service(packetsPerEvent);
+      events++;
+      bool received = !link.air.empty();
+      while (!link.air.empty()) {
+        SimulatedLink::Notification n = link.air.front();
+        link.air.pop_front();
+        if (n.control) {
+          client.onControl(n.packet);
+        } else {
+          client.onData(n.packet);
+        }
+      }
+      if (!received) client.onIdleEvent();
+    }
+  };
+
+  client.list();
+  runUntilIdle();
+  printf("%u ficheros, MTU %u, %u notificaciones por evento de %.2f ms, %u créditos\n",
+         (unsigned)client.files.size(), (unsigned)mtu, (unsigned)packetsPerEvent, intervalMs,
+         (unsigned)credits);
+  printf("%-8s %10s %10s %10s %8s %8s %s\n", "id", "bytes", "tiempo(s)", "kB/s", "reintentos",
+         "eficacia", "estado");
+
+  int exitCode = 0;
+  for (const FileInfo &file : client.files) {
+    uint64_t startEvents = events;
+    uint64_t startAir = link.bytesOnAir;
+    client.download(file.id);
+    runUntilIdle();
+
+    double seconds = (events - startEvents) * intervalMs / 1000.0;
+    bool ok = !client.failed && client.received == store.file(file.id);
+    double efficiency = link.bytesOnAir > startAir ? (double)file.size / (link.bytesOnAir - startAir) : 0;
+    printf("%-8u %10u %10.2f %10.1f %8u %7.1f%% %s\n", (unsigned)file.id, (unsigned)file.size,
+           seconds, seconds > 0 ? file.size / 1000.0 / seconds : 0.0, (unsigned)client.retries,
+           efficiency * 100, ok ? "ok" : "ERROR");
+    if (!ok) exitCode = 1;
+
+    if (outDir != NULL && ok) {
+      char path[512];
+      snprintf(path, sizeof(path), "%s/%05u.bin", outDir, (unsigned)file.id);
+      std::ofstream out(path, std::ios::binary);
+      out.write((const char *)client.received.data(), (std::streamsize)client.received.size());
+    }
+  }
+  printf("fragmentos enviados %u, perdidos %u, alterados %u\n", (unsigned)server.chunksSent(),
+         (unsigned)link.lost, (unsigned)link.corrupted);
+  return exitCode;
+}